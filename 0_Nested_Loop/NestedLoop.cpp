@@ -14,7 +14,11 @@
 
 #include <iostream>
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <utility>
 #include "NestedLoopUtils.hpp"
+#include "NestedLoopJoin.hpp"
 
 
 
@@ -45,11 +49,19 @@ TEST(NestedLoopTest, TestParsingTitleData) {
 
 
 //==--------------------------------------------------------------------==//
-//==------------------- TODO: JOIN IMPLEMENTATION ----------------------==//
+//==------------------------ JOIN IMPLEMENTATION -----------------------==//
 //==--------------------------------------------------------------------==//
 
-std::vector<ResultRelation> performNestedLoopJoin(const std::vector<CastRelation>& leftRelation, const std::vector<TitleRelation>& rightRelation) {
-    // TODO: Implement the nested loop join algorithm
+std::vector<ResultRelation> performNestedLoopJoin(const std::vector<CastRelation>& leftRelation, const std::vector<TitleRelation>& rightRelation,
+                                                  const NestedLoopOptions& options = {}) {
+    switch (options.algorithm) {
+    case NestedLoopAlgorithm::Blocked:
+        return blockNestedLoopJoin(leftRelation, rightRelation, &CastRelation::movieId, &TitleRelation::titleId, std::equal_to<>(), options);
+    case NestedLoopAlgorithm::SortedIndex:
+        return indexNestedLoopJoin(leftRelation, rightRelation, SortedTitleIndex(rightRelation, options.numThreads), options);
+    case NestedLoopAlgorithm::HashIndex:
+        return indexNestedLoopJoin(leftRelation, rightRelation, TitleHashIndex(rightRelation, options.numThreads), options);
+    }
     return {};
 }
 
@@ -70,3 +82,98 @@ TEST(NestedLoopTest, TestJoiningTuples) {
     }
     std::cout << "\n\n";
 }
+
+//==--------------------------------------------------------------------==//
+//==--------------------------- JOIN TESTS -----------------------------==//
+//==--------------------------------------------------------------------==//
+
+// Unsorted relations with duplicate titleIds and cast tuples without a matching title
+static std::pair<std::vector<CastRelation>, std::vector<TitleRelation>> createRelations(size_t castSize, size_t titleSize) {
+    std::mt19937 generator(7);
+    std::vector<TitleRelation> titles(titleSize);
+    for (size_t i = 0; i < titleSize; ++i) {
+        titles[i] = {};
+        titles[i].titleId = static_cast<int32_t>(generator() % (titleSize - titleSize / 8));
+        titles[i].productionYear = static_cast<int32_t>(i);
+    }
+    std::vector<CastRelation> casts(castSize);
+    for (size_t i = 0; i < castSize; ++i) {
+        casts[i] = {};
+        casts[i].castInfoId = static_cast<int32_t>(i);
+        casts[i].movieId = static_cast<int32_t>(generator() % (titleSize + titleSize / 4));
+    }
+    return {casts, titles};
+}
+
+// (castInfoId, productionYear) pairs identify a result tuple of the relations above
+static std::vector<std::pair<int32_t, int32_t>> resultKeys(const std::vector<ResultRelation>& result) {
+    std::vector<std::pair<int32_t, int32_t>> keys;
+    for (const ResultRelation& tuple : result) {
+        keys.emplace_back(tuple.castInfoId, tuple.productionYear);
+    }
+    std::ranges::sort(keys);
+    return keys;
+}
+
+template <typename Predicate>
+static std::vector<std::pair<int32_t, int32_t>> referenceJoin(const std::vector<CastRelation>& casts, const std::vector<TitleRelation>& titles, Predicate predicate) {
+    std::vector<std::pair<int32_t, int32_t>> keys;
+    for (const CastRelation& cast : casts) {
+        for (const TitleRelation& title : titles) {
+            if (predicate(cast, title)) {
+                keys.emplace_back(cast.castInfoId, title.productionYear);
+            }
+        }
+    }
+    std::ranges::sort(keys);
+    return keys;
+}
+
+TEST(NestedLoopTest, TestJoinAlgorithmsMatchReference) {
+    const auto [casts, titles] = createRelations(20000, 3000);
+    const auto expected = referenceJoin(casts, titles, [](const CastRelation& cast, const TitleRelation& title) {
+        return cast.movieId == title.titleId;
+    });
+    ASSERT_FALSE(expected.empty());
+
+    for (const auto algorithm : {NestedLoopAlgorithm::Blocked, NestedLoopAlgorithm::SortedIndex, NestedLoopAlgorithm::HashIndex}) {
+        for (const int numThreads : {1, 4}) {
+            NestedLoopOptions options;
+            options.algorithm = algorithm;
+            options.numThreads = numThreads;
+            EXPECT_EQ(resultKeys(performNestedLoopJoin(casts, titles, options)), expected);
+            // Blocks that do not divide the relations
+            options.outerBlockSize = 1000;
+            options.innerBlockSize = 333;
+            EXPECT_EQ(resultKeys(performNestedLoopJoin(casts, titles, options)), expected);
+        }
+    }
+}
+
+TEST(NestedLoopTest, TestJoinWithSmallOuterRelation) {
+    const auto [casts, titles] = createRelations(5, 50000);
+    const auto expected = referenceJoin(casts, titles, [](const CastRelation& cast, const TitleRelation& title) {
+        return cast.movieId == title.titleId;
+    });
+    NestedLoopOptions options;
+    options.algorithm = NestedLoopAlgorithm::Blocked;
+    options.numThreads = 4;
+    EXPECT_EQ(resultKeys(performNestedLoopJoin(casts, titles, options)), expected);
+    EXPECT_TRUE(performNestedLoopJoin({}, titles, options).empty());
+    EXPECT_TRUE(performNestedLoopJoin(casts, {}, options).empty());
+}
+
+TEST(NestedLoopTest, TestBlockedJoinEvaluatesBandPredicate) {
+    const auto [casts, titles] = createRelations(5000, 2000);
+    const auto band = [](int32_t movieId, int32_t titleId) { return movieId >= titleId - 1 && movieId <= titleId + 1; };
+    const auto expected = referenceJoin(casts, titles, [&](const CastRelation& cast, const TitleRelation& title) {
+        return band(cast.movieId, title.titleId);
+    });
+
+    NestedLoopOptions options;
+    options.numThreads = 4;
+    options.outerBlockSize = 700;
+    options.innerBlockSize = 128;
+    const auto result = blockNestedLoopJoin(casts, titles, &CastRelation::movieId, &TitleRelation::titleId, band, options);
+    EXPECT_EQ(resultKeys(result), expected);
+}
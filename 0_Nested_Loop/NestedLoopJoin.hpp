@@ -0,0 +1,265 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef NESTEDLOOPJOIN_HPP
+#define NESTEDLOOPJOIN_HPP
+
+#include "NestedLoopUtils.hpp"
+#include "CacheInfo.hpp"
+#include <omp.h>
+#include <parallel/algorithm>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+//==--------------------------------------------------------------------==//
+//==---------------------- NESTED LOOP JOIN FAMILY ---------------------==//
+//==--------------------------------------------------------------------==//
+
+enum class NestedLoopAlgorithm {
+    // Cache-blocked nested loop over the projected keys; also evaluates non-equi predicates
+    Blocked,
+    // Binary search per cast tuple in a sorted (titleId, row) index
+    SortedIndex,
+    // Lookup per cast tuple in an open addressing hash index on titleId
+    HashIndex,
+};
+
+struct NestedLoopOptions {
+    NestedLoopAlgorithm algorithm = NestedLoopAlgorithm::HashIndex;
+    int numThreads = omp_get_max_threads();
+    // Keys per outer (cast) and inner (title) block of the blocked join. 0 sizes the outer block
+    // to half of the L2 and the inner block to half of the L1 cache.
+    size_t outerBlockSize = 0;
+    size_t innerBlockSize = 0;
+};
+
+// Row ids of one matching cast/title pair
+struct MatchPair {
+    uint32_t castIndex;
+    uint32_t titleIndex;
+};
+
+// Cast tuples probed per task of the index joins
+static constexpr size_t INDEX_PROBE_CHUNK = 16 * 1024;
+// The blocked join cuts the inner relation into more segments when there are fewer outer blocks
+// than this many tasks per thread, so a small outer relation still keeps all threads busy
+static constexpr size_t BLOCKED_TASKS_PER_THREAD = 4;
+static constexpr uint32_t INDEX_EMPTY = UINT32_MAX;
+
+// Builds the result tuples of per-task match lists, in task order, into one preallocated result
+inline std::vector<ResultRelation> materializeMatches(const std::vector<CastRelation>& castRelation, const std::vector<TitleRelation>& titleRelation,
+                                                      const std::vector<std::vector<MatchPair>>& taskMatches, int numThreads) {
+    std::vector<size_t> offsets(taskMatches.size() + 1, 0);
+    for (size_t task = 0; task < taskMatches.size(); ++task) {
+        offsets[task + 1] = offsets[task] + taskMatches[task].size();
+    }
+    std::vector<ResultRelation> result(offsets.back());
+
+#pragma omp parallel for schedule(dynamic) num_threads(numThreads) shared(castRelation, titleRelation, taskMatches, offsets, result)
+    for (size_t task = 0; task < taskMatches.size(); ++task) {
+        ResultRelation* output = result.data() + offsets[task];
+        for (const MatchPair& match : taskMatches[task]) {
+            *output++ = createResultTuple(castRelation[match.castIndex], titleRelation[match.titleIndex]);
+        }
+    }
+    return result;
+}
+
+// Joins every cast tuple with every title tuple for which predicate(castKey(cast), titleKey(title))
+// holds. The keys are projected into two dense arrays first, so the quadratic part never touches
+// the fat tuples. Every task pairs one outer block (L2 sized) with one segment of the inner keys,
+// which it scans in L1 sized blocks: an inner block is reused by every key of the outer block
+// before the next one is loaded, and the outer block stays in the L2 across all inner blocks.
+template <typename CastProjection, typename TitleProjection, typename Predicate>
+std::vector<ResultRelation> blockNestedLoopJoin(const std::vector<CastRelation>& castRelation, const std::vector<TitleRelation>& titleRelation,
+                                                CastProjection castKey, TitleProjection titleKey, Predicate predicate, const NestedLoopOptions& options = {}) {
+    using CastKey = std::decay_t<std::invoke_result_t<CastProjection, const CastRelation&>>;
+    using TitleKey = std::decay_t<std::invoke_result_t<TitleProjection, const TitleRelation&>>;
+    std::vector<CastKey> cast_keys(castRelation.size());
+    std::vector<TitleKey> title_keys(titleRelation.size());
+    std::ranges::transform(castRelation, cast_keys.begin(), castKey);
+    std::ranges::transform(titleRelation, title_keys.begin(), titleKey);
+
+    const size_t outer_block = options.outerBlockSize != 0 ? options.outerBlockSize : std::max<size_t>(cacheSizes().l2 / 2 / sizeof(CastKey), 1);
+    const size_t inner_block = options.innerBlockSize != 0 ? options.innerBlockSize : std::max<size_t>(cacheSizes().l1d / 2 / sizeof(TitleKey), 1);
+    const size_t num_outer = (cast_keys.size() + outer_block - 1) / outer_block;
+    const size_t wanted_tasks = static_cast<size_t>(std::max(options.numThreads, 1)) * BLOCKED_TASKS_PER_THREAD;
+    const size_t num_inner_blocks = std::max<size_t>((title_keys.size() + inner_block - 1) / inner_block, 1);
+    const size_t num_segments = std::clamp<size_t>((wanted_tasks + num_outer - 1) / std::max<size_t>(num_outer, 1), 1, num_inner_blocks);
+    std::vector<std::vector<MatchPair>> task_matches(num_outer * num_segments);
+
+#pragma omp parallel for schedule(dynamic) num_threads(options.numThreads) shared(cast_keys, title_keys, task_matches, predicate)
+    for (size_t task = 0; task < task_matches.size(); ++task) {
+        const size_t outer_begin = task / num_segments * outer_block;
+        const size_t outer_end = std::min(outer_begin + outer_block, cast_keys.size());
+        // Segments are whole inner blocks
+        const size_t segment = task % num_segments;
+        const size_t segment_begin = segment * num_inner_blocks / num_segments * inner_block;
+        const size_t segment_end = std::min((segment + 1) * num_inner_blocks / num_segments * inner_block, title_keys.size());
+        std::vector<MatchPair>& matches = task_matches[task];
+
+        for (size_t inner_begin = segment_begin; inner_begin < segment_end; inner_begin += inner_block) {
+            const size_t inner_end = std::min(inner_begin + inner_block, segment_end);
+            for (size_t c = outer_begin; c < outer_end; ++c) {
+                const CastKey& key = cast_keys[c];
+                for (size_t t = inner_begin; t < inner_end; ++t) {
+                    if (predicate(key, title_keys[t])) {
+                        matches.push_back({static_cast<uint32_t>(c), static_cast<uint32_t>(t)});
+                    }
+                }
+            }
+        }
+    }
+
+    return materializeMatches(castRelation, titleRelation, task_matches, options.numThreads);
+}
+
+// Flips the sign bit, so that the unsigned order of the result is the signed order of key
+inline uint32_t orderedKey(int32_t key) {
+    return static_cast<uint32_t>(key) ^ 0x80000000u;
+}
+
+// titleIds sorted next to their row ids; the key array alone is binary searched
+class SortedTitleIndex {
+  public:
+    explicit SortedTitleIndex(const std::vector<TitleRelation>& titleRelation, int numThreads = omp_get_max_threads()) {
+        // (titleId, row) packed into one integer that orders by titleId first, sorted in parallel
+        std::vector<uint64_t> entries(titleRelation.size());
+#pragma omp parallel for schedule(static) num_threads(numThreads) shared(titleRelation, entries)
+        for (size_t row = 0; row < entries.size(); ++row) {
+            entries[row] = uint64_t{orderedKey(titleRelation[row].titleId)} << 32 | row;
+        }
+        __gnu_parallel::sort(entries.begin(), entries.end(), __gnu_parallel::multiway_mergesort_tag(static_cast<__gnu_parallel::_ThreadIndex>(std::max(numThreads, 1))));
+
+        keys.resize(entries.size());
+        rows.resize(entries.size());
+#pragma omp parallel for schedule(static) num_threads(numThreads) shared(entries)
+        for (size_t i = 0; i < entries.size(); ++i) {
+            keys[i] = static_cast<int32_t>(orderedKey(static_cast<int32_t>(entries[i] >> 32)));
+            rows[i] = static_cast<uint32_t>(entries[i]);
+        }
+    }
+
+    // Calls emit(row) for every title row with titleId key
+    template <typename Emit>
+    void probe(int32_t key, Emit&& emit) const {
+        for (auto it = std::ranges::lower_bound(keys, key); it != keys.end() && *it == key; ++it) {
+            emit(rows[it - keys.begin()]);
+        }
+    }
+
+  private:
+    std::vector<int32_t> keys;
+    std::vector<uint32_t> rows;
+};
+
+// Open addressing hash table (linear probing, load factor <= 0.5) from titleId to its rows, which
+// are chained through next. A slot packs the titleId and the first row of its chain into 64 bits,
+// so the rows are inserted in parallel with one compare-and-swap each; chains list their rows in
+// no particular order.
+class TitleHashIndex {
+  public:
+    explicit TitleHashIndex(const std::vector<TitleRelation>& titleRelation, int numThreads = omp_get_max_threads()) {
+        const size_t capacity = std::bit_ceil(std::max<size_t>(2 * titleRelation.size(), 2));
+        mask = capacity - 1;
+        slots.assign(capacity, EMPTY_SLOT);
+        next.resize(titleRelation.size());
+#pragma omp parallel for schedule(static) num_threads(numThreads) shared(titleRelation)
+        for (size_t row = 0; row < titleRelation.size(); ++row) {
+            insert(titleRelation[row].titleId, static_cast<uint32_t>(row));
+        }
+    }
+
+    template <typename Emit>
+    void probe(int32_t key, Emit&& emit) const {
+        size_t slot = hash(key) & mask;
+        while (firstRow(slots[slot]) != INDEX_EMPTY) {
+            if (slotKey(slots[slot]) == key) {
+                for (uint32_t row = firstRow(slots[slot]); row != INDEX_EMPTY; row = next[row]) {
+                    emit(row);
+                }
+                return;
+            }
+            slot = (slot + 1) & mask;
+        }
+    }
+
+  private:
+    static constexpr uint64_t EMPTY_SLOT = UINT64_MAX;
+
+    static uint64_t packSlot(int32_t key, uint32_t row) { return uint64_t{static_cast<uint32_t>(key)} << 32 | row; }
+    static int32_t slotKey(uint64_t slot) { return static_cast<int32_t>(slot >> 32); }
+    static uint32_t firstRow(uint64_t slot) { return static_cast<uint32_t>(slot); }
+
+    // Prepends row to the chain of key, claiming an empty slot for a new key. Only this thread
+    // writes next[row]; the end of the parallel build publishes it to the probing threads.
+    void insert(int32_t key, uint32_t row) {
+        size_t slot = hash(key) & mask;
+        uint64_t entry = std::atomic_ref<uint64_t>(slots[slot]).load(std::memory_order_relaxed);
+        while (true) {
+            if (firstRow(entry) != INDEX_EMPTY && slotKey(entry) != key) {
+                slot = (slot + 1) & mask;
+                entry = std::atomic_ref<uint64_t>(slots[slot]).load(std::memory_order_relaxed);
+                continue;
+            }
+            next[row] = firstRow(entry);
+            // A failed exchange reloads entry, which is then checked again
+            if (std::atomic_ref<uint64_t>(slots[slot]).compare_exchange_weak(entry, packSlot(key, row), std::memory_order_relaxed)) {
+                return;
+            }
+        }
+    }
+
+    // Murmur3 finalizer, so dense titleIds do not form long probe runs
+    static uint32_t hash(int32_t key) {
+        auto h = static_cast<uint32_t>(key);
+        h ^= h >> 16;
+        h *= 0x85ebca6b;
+        h ^= h >> 13;
+        h *= 0xc2b2ae35;
+        h ^= h >> 16;
+        return h;
+    }
+
+    size_t mask;
+    std::vector<uint64_t> slots;
+    std::vector<uint32_t> next;
+};
+
+// Index nested loop join: every cast tuple probes the index on titleId. Chunks of the cast
+// relation are probed in parallel and their matches materialized in cast order.
+template <typename Index>
+std::vector<ResultRelation> indexNestedLoopJoin(const std::vector<CastRelation>& castRelation, const std::vector<TitleRelation>& titleRelation,
+                                                const Index& index, const NestedLoopOptions& options = {}) {
+    std::vector<std::vector<MatchPair>> task_matches((castRelation.size() + INDEX_PROBE_CHUNK - 1) / INDEX_PROBE_CHUNK);
+
+#pragma omp parallel for schedule(dynamic) num_threads(options.numThreads) shared(castRelation, index, task_matches)
+    for (size_t task = 0; task < task_matches.size(); ++task) {
+        const size_t end = std::min((task + 1) * INDEX_PROBE_CHUNK, castRelation.size());
+        std::vector<MatchPair>& matches = task_matches[task];
+        for (size_t c = task * INDEX_PROBE_CHUNK; c < end; ++c) {
+            index.probe(castRelation[c].movieId, [&](uint32_t row) {
+                matches.push_back({static_cast<uint32_t>(c), row});
+            });
+        }
+    }
+
+    return materializeMatches(castRelation, titleRelation, task_matches, options.numThreads);
+}
+
+#endif // NESTEDLOOPJOIN_HPP
@@ -15,8 +15,20 @@
 #ifndef NESTEDLOOPUTILS_HPP
 #define NESTEDLOOPUTILS_HPP
 
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
 #include <cstring>
-#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 //==--------------------------------------------------------------------==//
 //==------------------ RELATION & RELATION UTILITY----------------------==//
@@ -129,34 +141,46 @@ struct ResultRelation {
     return oss.str();
 }
 
-inline void assignValueFromString(TitleRelation& titleRelation, const std::string& value, const size_t fieldIndex) {
+// Copies a CSV field with strncpy semantics: at most Size bytes, the rest of the array is zero padded
+template <size_t Size>
+inline void copyField(char (&target)[Size], std::string_view value) {
+    const size_t length = std::min(value.size(), Size);
+    std::memcpy(target, value.data(), length);
+    std::memset(target + length, 0, Size - length);
+}
+
+inline bool parseInt(int32_t& target, std::string_view value) {
+    return std::from_chars(value.data(), value.data() + value.size(), target).ec == std::errc();
+}
+
+inline bool assignValueFromString(TitleRelation& titleRelation, std::string_view value, const size_t fieldIndex) {
     switch (fieldIndex) {
-        case 0: titleRelation.titleId = std::stoi(value); break;
-        case 1: strncpy(titleRelation.title, value.c_str(), 200); break;
-        case 2: strncpy(titleRelation.imdbIndex, value.c_str(), 12); break;
-        case 3: titleRelation.kindId = std::stoi(value); break;
-        case 4: titleRelation.productionYear = std::stoi(value); break;
-        case 5: titleRelation.imdbId = std::stoi(value); break;
-        case 6: strncpy(titleRelation.phoneticCode, value.c_str(), 5); break;
-        case 7: titleRelation.episodeOfId = std::stoi(value); break;
-        case 8: titleRelation.seasonNr = std::stoi(value); break;
-        case 9: titleRelation.episodeNr = std::stoi(value); break;
-        case 10: strncpy(titleRelation.seriesYears, value.c_str(), 49); break;
-        case 11: strncpy(titleRelation.md5sum, value.c_str(), 32); break;
-        default: break;
+        case 0: return parseInt(titleRelation.titleId, value);
+        case 1: copyField(titleRelation.title, value); return true;
+        case 2: copyField(titleRelation.imdbIndex, value); return true;
+        case 3: return parseInt(titleRelation.kindId, value);
+        case 4: return parseInt(titleRelation.productionYear, value);
+        case 5: return parseInt(titleRelation.imdbId, value);
+        case 6: copyField(titleRelation.phoneticCode, value); return true;
+        case 7: return parseInt(titleRelation.episodeOfId, value);
+        case 8: return parseInt(titleRelation.seasonNr, value);
+        case 9: return parseInt(titleRelation.episodeNr, value);
+        case 10: copyField(titleRelation.seriesYears, value); return true;
+        case 11: copyField(titleRelation.md5sum, value); return true;
+        default: return false;
     }
 }
 
-inline void assignValueFromString(CastRelation& castRelation, const std::string& value, const size_t fieldIndex) {
+inline bool assignValueFromString(CastRelation& castRelation, std::string_view value, const size_t fieldIndex) {
     switch (fieldIndex) {
-        case 0: castRelation.castInfoId = std::stoi(value); break;
-        case 1: castRelation.personId = std::stoi(value); break;
-        case 2: castRelation.movieId = std::stoi(value); break;
-        case 3: castRelation.personRoleId = std::stoi(value); break;
-        case 4: strncpy(castRelation.note, value.c_str(), 100); break;
-        case 5: castRelation.nrOrder = std::stoi(value); break;
-        case 6: castRelation.roleId = std::stoi(value); break;
-        default: break;
+        case 0: return parseInt(castRelation.castInfoId, value);
+        case 1: return parseInt(castRelation.personId, value);
+        case 2: return parseInt(castRelation.movieId, value);
+        case 3: return parseInt(castRelation.personRoleId, value);
+        case 4: copyField(castRelation.note, value); return true;
+        case 5: return parseInt(castRelation.nrOrder, value);
+        case 6: return parseInt(castRelation.roleId, value);
+        default: return false;
     }
 }
 
@@ -164,43 +188,87 @@ inline void assignValueFromString(CastRelation& castRelation, const std::string&
 //==--------------------- DATASET LOADING LOGIC ------------------------==//
 //==--------------------------------------------------------------------==//
 
-inline bool parseLine(const std::string& line, TitleRelation& record) {
-    std::istringstream ss(line);
-    std::string field;
-    size_t fieldIndex = 0;
-
-    while (std::getline(ss, field, ',')) {
-        if (fieldIndex >= NUM_FIELDS_TITLE_RELATION) {
-            std::cerr << "Error: Too many fields in CSV line" << std::endl;
-            return false;
+// Read-only memory mapping of a whole file. The loader parses straight out of the
+// page cache instead of copying every line into a std::string first.
+class MappedFile {
+  public:
+    explicit MappedFile(const std::string& filename) {
+        const int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
         }
-        assignValueFromString(record, field, fieldIndex);
-        fieldIndex++;
+        struct stat fileStat{};
+        if (fstat(fd, &fileStat) == 0) {
+            fileSize = static_cast<size_t>(fileStat.st_size);
+            if (fileSize == 0) {
+                opened = true;
+            } else if (void* mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0); mapping != MAP_FAILED) {
+                madvise(mapping, fileSize, MADV_SEQUENTIAL);
+                fileData = static_cast<const char*>(mapping);
+                opened = true;
+            }
+        }
+        close(fd);
     }
 
-    if (fieldIndex != NUM_FIELDS_TITLE_RELATION) {
-        std::cerr << "Error: Too few fields in CSV line" << std::endl;
-        return false;
+    ~MappedFile() {
+        if (fileData != nullptr) {
+            munmap(const_cast<char*>(fileData), fileSize);
+        }
     }
 
-    return true;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] bool isOpen() const { return opened; }
+    [[nodiscard]] const char* data() const { return fileData; }
+    [[nodiscard]] size_t size() const { return fileSize; }
+
+  private:
+    const char* fileData = nullptr;
+    size_t fileSize = 0;
+    bool opened = false;
+};
+
+// Start of the line following position (memchr scans for the newline with SIMD)
+inline const char* nextLine(const char* position, const char* end) {
+    const auto* newline = static_cast<const char*>(std::memchr(position, '\n', end - position));
+    return newline != nullptr ? newline + 1 : end;
 }
 
-inline bool parseLine(const std::string& line, CastRelation& record) {
-    std::istringstream ss(line);
-    std::string field;
-    size_t fieldIndex = 0;
+// Number of lines in [position, end), counting at most limit lines
+inline size_t countLines(const char* position, const char* end, const size_t limit) {
+    size_t lines = 0;
+    while (position < end && lines < limit) {
+        position = nextLine(position, end);
+        lines++;
+    }
+    return lines;
+}
 
-    while (std::getline(ss, field, ',')) {
-        if (fieldIndex >= NUM_FIELD_CAST_RELATION) {
+// Splits a line at the commas and assigns every field without allocating
+template <typename Relation>
+bool parseFields(std::string_view line, Relation& record, const size_t numberOfFields) {
+    size_t fieldIndex = 0;
+    while (true) {
+        const auto* delimiter = static_cast<const char*>(std::memchr(line.data(), ',', line.size()));
+        const size_t length = delimiter != nullptr ? static_cast<size_t>(delimiter - line.data()) : line.size();
+        if (fieldIndex >= numberOfFields) {
             std::cerr << "Error: Too many fields in CSV line" << std::endl;
             return false;
         }
-        assignValueFromString(record, field, fieldIndex);
+        if (!assignValueFromString(record, line.substr(0, length), fieldIndex)) {
+            std::cerr << "Error: Invalid value in CSV field " << fieldIndex << std::endl;
+            return false;
+        }
         fieldIndex++;
+        if (delimiter == nullptr) {
+            break;
+        }
+        line.remove_prefix(length + 1);
     }
 
-    if (fieldIndex != NUM_FIELD_CAST_RELATION) {
+    if (fieldIndex != numberOfFields) {
         std::cerr << "Error: Too few fields in CSV line" << std::endl;
         return false;
     }
@@ -208,36 +276,75 @@ inline bool parseLine(const std::string& line, CastRelation& record) {
     return true;
 }
 
-template <typename Relation>
-std::vector<Relation> load(const std::string& filename, const size_t numberOfTuples = SIZE_MAX) {
-    std::vector<Relation> data;
-    std::ifstream file(filename);
-    if (!file.is_open()) {
+inline bool parseLine(std::string_view line, TitleRelation& record) {
+    return parseFields(line, record, NUM_FIELDS_TITLE_RELATION);
+}
+
+inline bool parseLine(std::string_view line, CastRelation& record) {
+    return parseFields(line, record, NUM_FIELD_CAST_RELATION);
+}
+
+// Container is std::vector<Relation> or any type providing reserve, emplace_back(const Relation&) and size()
+template <typename Relation, typename Container = std::vector<Relation>>
+Container load(const std::string& filename, const size_t numberOfTuples = SIZE_MAX) {
+    Container data;
+    const MappedFile file(filename);
+    if (!file.isOpen()) {
         std::cerr << "Error: Failed to open file " << filename << std::endl;
         exit(-1);
     }
 
-    std::string line;
-    bool firstLine = true;
-    while (std::getline(file, line)) {
-        if (firstLine) {
-            firstLine = false;
-            continue;
+    const char* const end = file.data() + file.size();
+    // Skip the header line
+    const char* position = file.size() > 0 ? nextLine(file.data(), end) : end;
+
+    // Allocate the storage once; std::vector rows are parsed in place
+    constexpr bool parseInPlace = std::is_same_v<Container, std::vector<Relation>>;
+    const size_t capacity = countLines(position, end, numberOfTuples);
+    if constexpr (parseInPlace) {
+        data.resize(capacity);
+    } else {
+        data.reserve(capacity);
+    }
+
+    size_t loaded = 0;
+    while (position < end && loaded < numberOfTuples) {
+        const char* lineEnd = nextLine(position, end);
+        std::string_view line(position, lineEnd - position);
+        position = lineEnd;
+        if (!line.empty() && line.back() == '\n') {
+            line.remove_suffix(1);
+        }
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+
+        bool parsed;
+        if constexpr (parseInPlace) {
+            parsed = parseLine(line, data[loaded]);
+        } else {
+            Relation record;
+            parsed = parseLine(line, record);
+            if (parsed) {
+                data.emplace_back(record);
+            }
         }
-        Relation record;
-        if (parseLine(line, record)) {
-            data.emplace_back(record);
+
+        if (parsed) {
+            loaded++;
         } else {
             std::cerr << "Error: Failed to parse line: " << line << std::endl;
         }
 
-        if (data.size() >= numberOfTuples) {
+        if (loaded >= numberOfTuples) {
             std::cout << "Loaded enough tuples. Returning now..." << std::endl;
             break;
         }
     }
 
-    file.close();
+    if constexpr (parseInPlace) {
+        data.resize(loaded);
+    }
     std::cout << "Loaded " << data.size() << " tuples from file." << std::endl;
     return data;
 }
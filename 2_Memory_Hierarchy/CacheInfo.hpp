@@ -0,0 +1,167 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef CACHEINFO_HPP
+#define CACHEINFO_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+//==--------------------------------------------------------------------==//
+//==---------------------- CACHE SIZE DETECTION ------------------------==//
+//==--------------------------------------------------------------------==//
+
+struct CacheSizes {
+    size_t l1d = 0;
+    size_t l2 = 0;
+    size_t l3 = 0;
+    size_t lineSize = 0;
+};
+
+// Used for every level that none of the sources below reports
+static constexpr CacheSizes DEFAULT_CACHE_SIZES{32 * 1024, 512 * 1024, 8 * 1024 * 1024, 64};
+
+// Parses sysfs cache sizes such as "48K" or "2M"
+inline size_t parseCacheSize(const std::string& text) {
+    size_t pos = 0;
+    size_t value = 0;
+    try {
+        value = std::stoull(text, &pos);
+    } catch (...) {
+        return 0;
+    }
+    if (pos < text.size()) {
+        switch (text[pos]) {
+            case 'K': return value << 10;
+            case 'M': return value << 20;
+            case 'G': return value << 30;
+            default: break;
+        }
+    }
+    return value;
+}
+
+inline void fillFromSysconf(CacheSizes& sizes) {
+    const auto query = [](int name) -> size_t {
+        const long value = sysconf(name);
+        return value > 0 ? static_cast<size_t>(value) : 0;
+    };
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+    sizes.l1d = sizes.l1d != 0 ? sizes.l1d : query(_SC_LEVEL1_DCACHE_SIZE);
+    sizes.l2 = sizes.l2 != 0 ? sizes.l2 : query(_SC_LEVEL2_CACHE_SIZE);
+    sizes.l3 = sizes.l3 != 0 ? sizes.l3 : query(_SC_LEVEL3_CACHE_SIZE);
+    sizes.lineSize = sizes.lineSize != 0 ? sizes.lineSize : query(_SC_LEVEL1_DCACHE_LINESIZE);
+#endif
+}
+
+// Cache description of cpu0 in /sys/devices/system/cpu/cpu0/cache/index*
+inline void fillFromSysfs(CacheSizes& sizes) {
+    for (int index = 0; index < 8; ++index) {
+        const std::string directory = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(index) + "/";
+        std::ifstream level_file(directory + "level");
+        std::ifstream type_file(directory + "type");
+        std::ifstream size_file(directory + "size");
+        std::ifstream line_file(directory + "coherency_line_size");
+        int level = 0;
+        std::string type;
+        std::string size_text;
+        if (!(level_file >> level) || !(type_file >> type) || !(size_file >> size_text) || type == "Instruction") {
+            continue;
+        }
+        const size_t size = parseCacheSize(size_text);
+        size_t& target = level == 1 ? sizes.l1d : level == 2 ? sizes.l2 : sizes.l3;
+        if (level <= 3 && target == 0) {
+            target = size;
+        }
+        size_t line_size = 0;
+        if (sizes.lineSize == 0 && line_file >> line_size) {
+            sizes.lineSize = line_size;
+        }
+    }
+}
+
+// Deterministic cache parameters of CPUID leaf 4 (Intel) or 0x8000001D (AMD)
+inline void fillFromCpuid(CacheSizes& sizes) {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned eax = 0;
+    unsigned ebx = 0;
+    unsigned ecx = 0;
+    unsigned edx = 0;
+    unsigned leaf = 4;
+    if (__get_cpuid_max(0x80000000, nullptr) >= 0x8000001D && __get_cpuid_count(0x8000001D, 0, &eax, &ebx, &ecx, &edx) && (eax & 0x1F) != 0) {
+        leaf = 0x8000001D;
+    } else if (__get_cpuid_max(0, nullptr) < 4) {
+        return;
+    }
+    for (unsigned subleaf = 0; subleaf < 16; ++subleaf) {
+        __cpuid_count(leaf, subleaf, eax, ebx, ecx, edx);
+        const unsigned type = eax & 0x1F;
+        if (type == 0) {
+            break;
+        }
+        if (type == 2) {
+            continue; // Instruction cache
+        }
+        const unsigned level = (eax >> 5) & 0x7;
+        const size_t line_size = (ebx & 0xFFF) + 1;
+        const size_t size = (((ebx >> 22) & 0x3FF) + 1) * (((ebx >> 12) & 0x3FF) + 1) * line_size * (static_cast<size_t>(ecx) + 1);
+        size_t& target = level == 1 ? sizes.l1d : level == 2 ? sizes.l2 : sizes.l3;
+        if (level <= 3 && target == 0) {
+            target = size;
+        }
+        if (sizes.lineSize == 0) {
+            sizes.lineSize = line_size;
+        }
+    }
+#else
+    (void)sizes;
+#endif
+}
+
+// Asks sysconf first, then sysfs, then CPUID; levels none of them knows keep the defaults
+inline CacheSizes detectCacheSizes() {
+    CacheSizes sizes;
+    fillFromSysconf(sizes);
+    fillFromSysfs(sizes);
+    fillFromCpuid(sizes);
+    sizes.l1d = sizes.l1d != 0 ? sizes.l1d : DEFAULT_CACHE_SIZES.l1d;
+    sizes.l2 = sizes.l2 != 0 ? sizes.l2 : DEFAULT_CACHE_SIZES.l2;
+    sizes.l3 = sizes.l3 != 0 ? sizes.l3 : DEFAULT_CACHE_SIZES.l3;
+    sizes.lineSize = sizes.lineSize != 0 ? sizes.lineSize : DEFAULT_CACHE_SIZES.lineSize;
+    return sizes;
+}
+
+inline CacheSizes& cacheSizeStorage() {
+    static CacheSizes sizes = detectCacheSizes();
+    return sizes;
+}
+
+// Cache sizes of this machine, detected on first use
+inline const CacheSizes& cacheSizes() {
+    return cacheSizeStorage();
+}
+
+// Replaces the detected sizes, e.g. to tune for another machine. Must not race with a running join.
+inline void overrideCacheSizes(const CacheSizes& sizes) {
+    cacheSizeStorage() = sizes;
+}
+
+#endif // CACHEINFO_HPP
@@ -0,0 +1,382 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef COLUMNARRELATION_HPP
+#define COLUMNARRELATION_HPP
+
+#include "JoinUtils.hpp"
+#include <array>
+#include <cstdint>
+#include <memory>
+
+//==--------------------------------------------------------------------==//
+//==------------------- COLUMNAR (SoA) RELATIONS -----------------------==//
+//==--------------------------------------------------------------------==//
+
+// One column of a columnar relation. It either owns its values or is a view over a section of a
+// private file mapping (see readSnapshot), which it keeps alive. Values of a view are written in
+// place, so only the written pages are copied by the kernel; growing a view first copies it into
+// owned storage. Sizing owned storage leaves the values unwritten, like RelationVector.
+template <typename T>
+class Column {
+  public:
+    using value_type = T;
+
+    Column() = default;
+    Column(std::shared_ptr<const MappedFile> mapping, T* values, size_t count) : mapping(std::move(mapping)), values(values), count(count) {}
+
+    Column(const Column& other) : owned(other.owned), mapping(other.mapping), values(other.mapping ? other.values : owned.data()), count(other.count) {}
+    Column(Column&& other) noexcept { swap(other); }
+    Column& operator=(Column other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    void swap(Column& other) noexcept {
+        // Swapping the vectors keeps their buffers, so the value pointers stay valid
+        owned.swap(other.owned);
+        mapping.swap(other.mapping);
+        std::swap(values, other.values);
+        std::swap(count, other.count);
+    }
+
+    [[nodiscard]] size_t size() const { return count; }
+    [[nodiscard]] bool empty() const { return count == 0; }
+    [[nodiscard]] bool isMapped() const { return mapping != nullptr; }
+
+    [[nodiscard]] T* data() { return values; }
+    [[nodiscard]] const T* data() const { return values; }
+    [[nodiscard]] T* begin() { return values; }
+    [[nodiscard]] const T* begin() const { return values; }
+    [[nodiscard]] T* end() { return values + count; }
+    [[nodiscard]] const T* end() const { return values + count; }
+    [[nodiscard]] T& operator[](size_t i) { return values[i]; }
+    [[nodiscard]] const T& operator[](size_t i) const { return values[i]; }
+    [[nodiscard]] const T& back() const { return values[count - 1]; }
+
+    void reserve(size_t capacity) {
+        own(capacity);
+        owned.reserve(capacity);
+        values = owned.data();
+    }
+
+    // Shrinking a view only drops its tail
+    void resize(size_t newCount) {
+        if (!mapping || newCount > count) {
+            own(newCount);
+            owned.resize(newCount);
+            values = owned.data();
+        }
+        count = newCount;
+    }
+
+    T& emplace_back() {
+        own(count + 1);
+        T& value = owned.emplace_back();
+        values = owned.data();
+        ++count;
+        return value;
+    }
+
+    // Takes a copy, value may lie in this column
+    void push_back(T value) { emplace_back() = value; }
+
+  private:
+    // Copies a view into owned storage with room for capacity values
+    void own(size_t capacity) {
+        if (!mapping) {
+            return;
+        }
+        UninitializedVector<T> copy;
+        copy.reserve(std::max(capacity, count));
+        copy.assign(values, values + count);
+        owned.swap(copy);
+        mapping.reset();
+        values = owned.data();
+    }
+
+    UninitializedVector<T> owned;
+    std::shared_ptr<const MappedFile> mapping;
+    T* values = nullptr;
+    size_t count = 0;
+};
+
+// Struct-of-arrays version of CastRelation. The join key movieId is stored in its
+// own contiguous column, so the join kernel only streams 4 bytes per tuple.
+struct CastColumns {
+    Column<int32_t> castInfoId;
+    Column<int32_t> personId;
+    Column<int32_t> movieId;
+    Column<int32_t> personRoleId;
+    Column<std::array<char, sizeof(CastRelation::note)>> note;
+    Column<int32_t> nrOrder;
+    Column<int32_t> roleId;
+
+    // The movieId column is known to be sorted ascending (e.g. from a snapshot header), so the join
+    // skips its sortedness check. Resizing and appending reset it; whoever writes movieId in place
+    // has to reset it as well.
+    bool sortedByKey = false;
+
+    [[nodiscard]] size_t size() const { return movieId.size(); }
+    [[nodiscard]] bool empty() const { return movieId.empty(); }
+
+    void reserve(size_t numberOfTuples) {
+        castInfoId.reserve(numberOfTuples);
+        personId.reserve(numberOfTuples);
+        movieId.reserve(numberOfTuples);
+        personRoleId.reserve(numberOfTuples);
+        note.reserve(numberOfTuples);
+        nrOrder.reserve(numberOfTuples);
+        roleId.reserve(numberOfTuples);
+    }
+
+    void resize(size_t numberOfTuples) {
+        sortedByKey = false;
+        castInfoId.resize(numberOfTuples);
+        personId.resize(numberOfTuples);
+        movieId.resize(numberOfTuples);
+        personRoleId.resize(numberOfTuples);
+        note.resize(numberOfTuples);
+        nrOrder.resize(numberOfTuples);
+        roleId.resize(numberOfTuples);
+    }
+
+    // Overwrites row i; used by load<CastRelation, CastColumns> to fill rows in parallel
+    void set(size_t i, const CastRelation& record) {
+        castInfoId[i] = record.castInfoId;
+        personId[i] = record.personId;
+        movieId[i] = record.movieId;
+        personRoleId[i] = record.personRoleId;
+        std::memcpy(note[i].data(), record.note, sizeof(record.note));
+        nrOrder[i] = record.nrOrder;
+        roleId[i] = record.roleId;
+    }
+
+    // Appends one row
+    void emplace_back(const CastRelation& record) {
+        sortedByKey = false;
+        castInfoId.push_back(record.castInfoId);
+        personId.push_back(record.personId);
+        movieId.push_back(record.movieId);
+        personRoleId.push_back(record.personRoleId);
+        std::memcpy(note.emplace_back().data(), record.note, sizeof(record.note));
+        nrOrder.push_back(record.nrOrder);
+        roleId.push_back(record.roleId);
+    }
+
+    // Calls visit(column) for every column vector in schema order; Self is CastColumns or const CastColumns
+    template <typename Self, typename Visit>
+    static void forEachColumn(Self& self, Visit&& visit) {
+        visit(self.castInfoId);
+        visit(self.personId);
+        visit(self.movieId);
+        visit(self.personRoleId);
+        visit(self.note);
+        visit(self.nrOrder);
+        visit(self.roleId);
+    }
+
+    // Reassembles the i-th row
+    [[nodiscard]] CastRelation operator[](size_t i) const {
+        CastRelation record;
+        record.castInfoId = castInfoId[i];
+        record.personId = personId[i];
+        record.movieId = movieId[i];
+        record.personRoleId = personRoleId[i];
+        std::memcpy(record.note, note[i].data(), sizeof(record.note));
+        record.nrOrder = nrOrder[i];
+        record.roleId = roleId[i];
+        return record;
+    }
+};
+
+// Struct-of-arrays version of TitleRelation with the join key titleId in its own column.
+struct TitleColumns {
+    Column<int32_t> titleId;
+    Column<std::array<char, sizeof(TitleRelation::title)>> title;
+    Column<std::array<char, sizeof(TitleRelation::imdbIndex)>> imdbIndex;
+    Column<int32_t> kindId;
+    Column<int32_t> productionYear;
+    Column<int32_t> imdbId;
+    Column<std::array<char, sizeof(TitleRelation::phoneticCode)>> phoneticCode;
+    Column<int32_t> episodeOfId;
+    Column<int32_t> seasonNr;
+    Column<int32_t> episodeNr;
+    Column<std::array<char, sizeof(TitleRelation::seriesYears)>> seriesYears;
+    Column<std::array<char, sizeof(TitleRelation::md5sum)>> md5sum;
+
+    // The titleId column is known to be sorted ascending (e.g. from a snapshot header), so the join
+    // skips its sortedness check. Resizing and appending reset it; whoever writes titleId in place
+    // has to reset it as well.
+    bool sortedByKey = false;
+
+    [[nodiscard]] size_t size() const { return titleId.size(); }
+    [[nodiscard]] bool empty() const { return titleId.empty(); }
+
+    void reserve(size_t numberOfTuples) {
+        titleId.reserve(numberOfTuples);
+        title.reserve(numberOfTuples);
+        imdbIndex.reserve(numberOfTuples);
+        kindId.reserve(numberOfTuples);
+        productionYear.reserve(numberOfTuples);
+        imdbId.reserve(numberOfTuples);
+        phoneticCode.reserve(numberOfTuples);
+        episodeOfId.reserve(numberOfTuples);
+        seasonNr.reserve(numberOfTuples);
+        episodeNr.reserve(numberOfTuples);
+        seriesYears.reserve(numberOfTuples);
+        md5sum.reserve(numberOfTuples);
+    }
+
+    void resize(size_t numberOfTuples) {
+        sortedByKey = false;
+        titleId.resize(numberOfTuples);
+        title.resize(numberOfTuples);
+        imdbIndex.resize(numberOfTuples);
+        kindId.resize(numberOfTuples);
+        productionYear.resize(numberOfTuples);
+        imdbId.resize(numberOfTuples);
+        phoneticCode.resize(numberOfTuples);
+        episodeOfId.resize(numberOfTuples);
+        seasonNr.resize(numberOfTuples);
+        episodeNr.resize(numberOfTuples);
+        seriesYears.resize(numberOfTuples);
+        md5sum.resize(numberOfTuples);
+    }
+
+    // Overwrites row i; used by load<TitleRelation, TitleColumns> to fill rows in parallel
+    void set(size_t i, const TitleRelation& record) {
+        titleId[i] = record.titleId;
+        std::memcpy(title[i].data(), record.title, sizeof(record.title));
+        std::memcpy(imdbIndex[i].data(), record.imdbIndex, sizeof(record.imdbIndex));
+        kindId[i] = record.kindId;
+        productionYear[i] = record.productionYear;
+        imdbId[i] = record.imdbId;
+        std::memcpy(phoneticCode[i].data(), record.phoneticCode, sizeof(record.phoneticCode));
+        episodeOfId[i] = record.episodeOfId;
+        seasonNr[i] = record.seasonNr;
+        episodeNr[i] = record.episodeNr;
+        std::memcpy(seriesYears[i].data(), record.seriesYears, sizeof(record.seriesYears));
+        std::memcpy(md5sum[i].data(), record.md5sum, sizeof(record.md5sum));
+    }
+
+    // Appends one row
+    void emplace_back(const TitleRelation& record) {
+        sortedByKey = false;
+        titleId.push_back(record.titleId);
+        std::memcpy(title.emplace_back().data(), record.title, sizeof(record.title));
+        std::memcpy(imdbIndex.emplace_back().data(), record.imdbIndex, sizeof(record.imdbIndex));
+        kindId.push_back(record.kindId);
+        productionYear.push_back(record.productionYear);
+        imdbId.push_back(record.imdbId);
+        std::memcpy(phoneticCode.emplace_back().data(), record.phoneticCode, sizeof(record.phoneticCode));
+        episodeOfId.push_back(record.episodeOfId);
+        seasonNr.push_back(record.seasonNr);
+        episodeNr.push_back(record.episodeNr);
+        std::memcpy(seriesYears.emplace_back().data(), record.seriesYears, sizeof(record.seriesYears));
+        std::memcpy(md5sum.emplace_back().data(), record.md5sum, sizeof(record.md5sum));
+    }
+
+    // Calls visit(column) for every column vector in schema order; Self is TitleColumns or const TitleColumns
+    template <typename Self, typename Visit>
+    static void forEachColumn(Self& self, Visit&& visit) {
+        visit(self.titleId);
+        visit(self.title);
+        visit(self.imdbIndex);
+        visit(self.kindId);
+        visit(self.productionYear);
+        visit(self.imdbId);
+        visit(self.phoneticCode);
+        visit(self.episodeOfId);
+        visit(self.seasonNr);
+        visit(self.episodeNr);
+        visit(self.seriesYears);
+        visit(self.md5sum);
+    }
+
+    // Reassembles the i-th row
+    [[nodiscard]] TitleRelation operator[](size_t i) const {
+        TitleRelation record;
+        record.titleId = titleId[i];
+        std::memcpy(record.title, title[i].data(), sizeof(record.title));
+        std::memcpy(record.imdbIndex, imdbIndex[i].data(), sizeof(record.imdbIndex));
+        record.kindId = kindId[i];
+        record.productionYear = productionYear[i];
+        record.imdbId = imdbId[i];
+        std::memcpy(record.phoneticCode, phoneticCode[i].data(), sizeof(record.phoneticCode));
+        record.episodeOfId = episodeOfId[i];
+        record.seasonNr = seasonNr[i];
+        record.episodeNr = episodeNr[i];
+        std::memcpy(record.seriesYears, seriesYears[i].data(), sizeof(record.seriesYears));
+        std::memcpy(record.md5sum, md5sum[i].data(), sizeof(record.md5sum));
+        return record;
+    }
+};
+
+[[nodiscard]] inline CastColumns toColumns(const RelationVector<CastRelation>& relation) {
+    CastColumns columns;
+    columns.reserve(relation.size());
+    for (const auto& record : relation) {
+        columns.emplace_back(record);
+    }
+    return columns;
+}
+
+[[nodiscard]] inline TitleColumns toColumns(const RelationVector<TitleRelation>& relation) {
+    TitleColumns columns;
+    columns.reserve(relation.size());
+    for (const auto& record : relation) {
+        columns.emplace_back(record);
+    }
+    return columns;
+}
+
+inline CastColumns loadCastColumns(const std::string& filename, const size_t numberOfTuples = SIZE_MAX, const int numThreads = defaultLoadThreads()) {
+    return load<CastRelation, CastColumns>(filename, numberOfTuples, numThreads);
+}
+
+inline TitleColumns loadTitleColumns(const std::string& filename, const size_t numberOfTuples = SIZE_MAX, const int numThreads = defaultLoadThreads()) {
+    return load<TitleRelation, TitleColumns>(filename, numberOfTuples, numThreads);
+}
+
+// Builds the i-th cast x j-th title result tuple straight from the payload columns
+inline ResultRelation createResultTuple(const CastColumns& cast, size_t i, const TitleColumns& title, size_t j) {
+    ResultRelation result;
+    // Assign values from title to result
+    result.titleId = title.titleId[j];
+    std::memcpy(result.title, title.title[j].data(), 200);
+    std::memcpy(result.imdbIndex, title.imdbIndex[j].data(), 12);
+    result.kindId = title.kindId[j];
+    result.productionYear = title.productionYear[j];
+    result.imdbId = title.imdbId[j];
+    std::memcpy(result.phoneticCode, title.phoneticCode[j].data(), 5);
+    result.episodeOfId = title.episodeOfId[j];
+    result.seasonNr = title.seasonNr[j];
+    result.episodeNr = title.episodeNr[j];
+    std::memcpy(result.seriesYears, title.seriesYears[j].data(), 49);
+    std::memcpy(result.md5sum, title.md5sum[j].data(), 32);
+
+    // Assign values from castInfo to result
+    result.castInfoId = cast.castInfoId[i];
+    result.personId = cast.personId[i];
+    result.movieId = cast.movieId[i];
+    result.personRoleId = cast.personRoleId[i];
+    std::memcpy(result.note, cast.note[i].data(), 100);
+    result.nrOrder = cast.nrOrder[i];
+    result.roleId = cast.roleId[i];
+
+    return result;
+}
+
+#endif // COLUMNARRELATION_HPP
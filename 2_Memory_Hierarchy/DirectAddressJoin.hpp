@@ -0,0 +1,148 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DIRECTADDRESSJOIN_HPP
+#define DIRECTADDRESSJOIN_HPP
+
+#include "Join.hpp"
+#include <omp.h>
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <numeric>
+#include <optional>
+#include <vector>
+
+//==--------------------------------------------------------------------==//
+//==---------------------- DIRECT ADDRESS JOIN -------------------------==//
+//==--------------------------------------------------------------------==//
+
+// A titleId domain is dense if it spans at most this many slots per title tuple
+static constexpr int64_t DIRECT_ADDRESS_MAX_SLOTS_PER_TUPLE = 4;
+// Cast tuples one probe task scans
+static constexpr size_t DIRECT_ADDRESS_PROBE_CHUNK = 16 * 1024;
+// How many cast tuples ahead the probe prefetches the slot of
+static constexpr size_t DIRECT_ADDRESS_PREFETCH_DISTANCE = 16;
+static constexpr uint32_t DIRECT_ADDRESS_EMPTY = UINT32_MAX;
+
+// Title row of every titleId in [minKey, minKey + rows.size()); DIRECT_ADDRESS_EMPTY for gaps
+struct DirectAddressTable {
+    int32_t minKey = 0;
+    std::vector<uint32_t> rows;
+
+    // Slot of key, nullptr if key is outside of the domain
+    [[nodiscard]] const uint32_t* slot(int32_t key) const {
+        // Keys below minKey wrap around to large offsets
+        const auto offset = static_cast<uint64_t>(static_cast<int64_t>(key) - minKey);
+        return offset < rows.size() ? rows.data() + offset : nullptr;
+    }
+};
+
+// Smallest and largest join key of a non-empty relation
+struct KeyRange {
+    int32_t min = INT32_MAX;
+    int32_t max = INT32_MIN;
+
+    [[nodiscard]] int64_t domain() const { return static_cast<int64_t>(max) - min + 1; }
+};
+
+template <typename Keys>
+KeyRange keyRange(const Keys& keys, int numThreads) {
+    int32_t min_key = INT32_MAX;
+    int32_t max_key = INT32_MIN;
+#pragma omp parallel for schedule(static) num_threads(numThreads) reduction(min : min_key) reduction(max : max_key) shared(keys)
+    for (size_t i = 0; i < keys.size(); ++i) {
+        min_key = std::min<int32_t>(min_key, keys[i]);
+        max_key = std::max<int32_t>(max_key, keys[i]);
+    }
+    return {min_key, max_key};
+}
+
+// Builds the table if the titleIds are unique and dense, otherwise returns nothing. The domain is
+// found with a parallel min/max pass and the rows are scattered into the table in parallel; a
+// slot that is already taken means a duplicate titleId.
+template <typename TitleKeys>
+std::optional<DirectAddressTable> buildDirectAddressTable(const TitleKeys& titleKeys, int numThreads) {
+    if (titleKeys.size() == 0 || titleKeys.size() >= DIRECT_ADDRESS_EMPTY) {
+        return std::nullopt;
+    }
+    const KeyRange range = keyRange(titleKeys, numThreads);
+    if (range.domain() > DIRECT_ADDRESS_MAX_SLOTS_PER_TUPLE * static_cast<int64_t>(titleKeys.size())) {
+        return std::nullopt;
+    }
+
+    DirectAddressTable table{range.min, std::vector<uint32_t>(range.domain(), DIRECT_ADDRESS_EMPTY)};
+    bool duplicate = false;
+#pragma omp parallel for schedule(static) num_threads(numThreads) reduction(|| : duplicate) shared(titleKeys, table)
+    for (size_t row = 0; row < titleKeys.size(); ++row) {
+        uint32_t expected = DIRECT_ADDRESS_EMPTY;
+        std::atomic_ref<uint32_t> slot(table.rows[titleKeys[row] - table.minKey]);
+        if (!slot.compare_exchange_strong(expected, static_cast<uint32_t>(row), std::memory_order_relaxed)) {
+            duplicate = true;
+        }
+    }
+    if (duplicate) {
+        return std::nullopt;
+    }
+    return table;
+}
+
+// Calls emit(castRow, titleRow) for every match of the cast tuples [begin, end). The scan is
+// sequential, so only the table lookups are random and their slots are prefetched a few tuples ahead.
+template <typename CastKeys, typename Emit>
+void probeDirectAddressRange(const DirectAddressTable& table, const CastKeys& castKeys, size_t begin, size_t end, Emit&& emit) {
+    for (size_t i = begin; i < end; ++i) {
+        if (i + DIRECT_ADDRESS_PREFETCH_DISTANCE < end) {
+            if (const uint32_t* ahead = table.slot(castKeys[i + DIRECT_ADDRESS_PREFETCH_DISTANCE])) {
+                __builtin_prefetch(ahead);
+            }
+        }
+        const uint32_t* slot = table.slot(castKeys[i]);
+        if (slot != nullptr && *slot != DIRECT_ADDRESS_EMPTY) {
+            emit(static_cast<uint32_t>(i), *slot);
+        }
+    }
+}
+
+// Looks up the movieId of every cast tuple in the table. Like the merge join, chunks of the cast
+// relation count their matches in parallel, a prefix sum gives every chunk its output slot, and a
+// second parallel probe writes the matches straight into the uninitialized result. Returns the
+// row ids of all matches in cast order.
+template <typename CastKeys>
+JoinIndexVector probeDirectAddressTable(const DirectAddressTable& table, const CastKeys& castKeys, int numThreads) {
+    const size_t num_chunks = (castKeys.size() + DIRECT_ADDRESS_PROBE_CHUNK - 1) / DIRECT_ADDRESS_PROBE_CHUNK;
+    std::vector<size_t> offsets(num_chunks + 1, 0);
+
+#pragma omp parallel for schedule(dynamic) num_threads(numThreads) shared(table, castKeys, offsets)
+    for (size_t chunk = 0; chunk < num_chunks; ++chunk) {
+        const size_t begin = chunk * DIRECT_ADDRESS_PROBE_CHUNK;
+        size_t matches = 0;
+        probeDirectAddressRange(table, castKeys, begin, std::min(begin + DIRECT_ADDRESS_PROBE_CHUNK, castKeys.size()), [&](uint32_t, uint32_t) { ++matches; });
+        offsets[chunk + 1] = matches;
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+    JoinIndexVector indexPairs(offsets.back());
+#pragma omp parallel for schedule(dynamic) num_threads(numThreads) shared(table, castKeys, offsets, indexPairs)
+    for (size_t chunk = 0; chunk < num_chunks; ++chunk) {
+        const size_t begin = chunk * DIRECT_ADDRESS_PROBE_CHUNK;
+        JoinIndexPair* output = indexPairs.data() + offsets[chunk];
+        probeDirectAddressRange(table, castKeys, begin, std::min(begin + DIRECT_ADDRESS_PROBE_CHUNK, castKeys.size()),
+                                [&](uint32_t castRow, uint32_t titleRow) { *output++ = {castRow, titleRow}; });
+    }
+    return indexPairs;
+}
+
+#endif // DIRECTADDRESSJOIN_HPP
@@ -0,0 +1,336 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef GRACEHASHJOIN_HPP
+#define GRACEHASHJOIN_HPP
+
+#include "Join.hpp"
+#include "RadixHashJoin.hpp"
+#include <omp.h>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+//==--------------------------------------------------------------------==//
+//==------------------ GRACE / HYBRID HASH JOIN ------------------------==//
+//==--------------------------------------------------------------------==//
+
+// Hash partitions both inputs by the join key. Title partitions stay in memory as long as they
+// fit the memory budget; when they outgrow it, the largest resident partition is written to its
+// own file and all later title and cast tuples of that partition go to disk as well. Resident
+// partitions are probed while the cast input streams by, the spilled ones are joined one after
+// another afterwards. All disk accesses are large sequential writes and reads.
+
+static constexpr size_t GRACE_DEFAULT_PARTITIONS = 64;
+// Bytes a resident title occupies: the tuple plus its bucket head and chain entry
+static constexpr size_t GRACE_BYTES_PER_TITLE = sizeof(TitleRelation) + 2 * sizeof(uint32_t);
+
+struct GraceJoinOptions {
+    // Bytes the resident title partitions and their hash tables may occupy (I/O buffers excluded)
+    size_t memoryBudget = size_t{1} << 30;
+    // Directory of the partition files; they are unlinked right after creation
+    std::string spillDirectory = std::filesystem::temp_directory_path().string();
+    // Number of hash partitions, rounded up to a power of two
+    size_t numPartitions = GRACE_DEFAULT_PARTITIONS;
+    // Write buffer of every spilled partition and chunk size of the reads
+    size_t ioBufferSize = 1 << 20;
+    // Tuples requested from a reader per call
+    size_t batchSize = 1 << 16;
+    // Maximum number of result tuples per sink call
+    size_t resultBatchSize = 1 << 16;
+    int numThreads = 1;
+};
+
+struct GraceJoinStats {
+    size_t castTuples = 0;
+    size_t titleTuples = 0;
+    size_t resultTuples = 0;
+    size_t bytesSpilled = 0;
+    size_t bytesReadBack = 0;
+    size_t spilledPartitions = 0;
+    size_t residentPartitions = 0;
+};
+
+// Unnamed temporary file that tuples are appended to through a large write buffer
+template <typename Tuple>
+class SpillFile {
+  public:
+    SpillFile(const std::string& directory, size_t bufferSize) : capacity(std::max<size_t>(bufferSize / sizeof(Tuple), 1)) {
+        std::string path = directory + "/ppds_spill_XXXXXX";
+        fd = mkstemp(path.data());
+        if (fd < 0) {
+            std::cerr << "Error: Failed to create spill file in " << directory << std::endl;
+            exit(-1);
+        }
+        // The file disappears together with its descriptor
+        unlink(path.c_str());
+    }
+
+    ~SpillFile() {
+        close(fd);
+    }
+
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    void append(const Tuple& tuple) {
+        if (buffer.empty()) {
+            buffer.reserve(capacity);
+        }
+        buffer.push_back(tuple);
+        if (buffer.size() == capacity) {
+            flush();
+        }
+    }
+
+    // Large appends bypass the buffer
+    void append(std::span<const Tuple> tuples) {
+        flush();
+        writeAll(tuples.data(), tuples.size_bytes());
+    }
+
+    void flush() {
+        writeAll(buffer.data(), buffer.size() * sizeof(Tuple));
+        buffer.clear();
+    }
+
+    [[nodiscard]] size_t bytesWritten() const { return fileSize; }
+
+    // Reads the file from the start in chunks of the buffer size and calls consume(span) per chunk
+    template <typename Consume>
+    void readBack(Consume&& consume) {
+        flush();
+        std::vector<Tuple>().swap(buffer);
+        std::vector<Tuple> chunk(std::min(capacity, fileSize / sizeof(Tuple)));
+        for (size_t offset = 0; offset < fileSize;) {
+            const size_t bytes = std::min(chunk.size() * sizeof(Tuple), fileSize - offset);
+            readAll(chunk.data(), bytes, offset);
+            consume(std::span<const Tuple>(chunk.data(), bytes / sizeof(Tuple)));
+            offset += bytes;
+        }
+    }
+
+  private:
+    void writeAll(const void* data, size_t bytes) {
+        const auto* position = static_cast<const char*>(data);
+        while (bytes > 0) {
+            const ssize_t written = write(fd, position, bytes);
+            if (written <= 0) {
+                std::cerr << "Error: Failed to write spill file" << std::endl;
+                exit(-1);
+            }
+            position += written;
+            bytes -= static_cast<size_t>(written);
+            fileSize += static_cast<size_t>(written);
+        }
+    }
+
+    void readAll(void* data, size_t bytes, size_t offset) {
+        auto* position = static_cast<char*>(data);
+        while (bytes > 0) {
+            const ssize_t bytesRead = pread(fd, position, bytes, static_cast<off_t>(offset));
+            if (bytesRead <= 0) {
+                std::cerr << "Error: Failed to read spill file" << std::endl;
+                exit(-1);
+            }
+            position += bytesRead;
+            offset += static_cast<size_t>(bytesRead);
+            bytes -= static_cast<size_t>(bytesRead);
+        }
+    }
+
+    int fd = -1;
+    size_t capacity;
+    size_t fileSize = 0;
+    std::vector<Tuple> buffer;
+};
+
+// Bucket-chained hash table over the titles of one partition, laid out like the tables of the radix join
+class TitleHashTable {
+  public:
+    void build(std::span<const TitleRelation> partition) {
+        titles = partition;
+        const size_t buckets = std::bit_ceil(std::max<size_t>(titles.size(), 1));
+        mask = static_cast<uint32_t>(buckets - 1);
+        head.assign(buckets, RADIX_CHAIN_END);
+        next.resize(titles.size());
+        for (size_t i = 0; i < titles.size(); ++i) {
+            const uint32_t bucket = radixHash(titles[i].titleId) & mask;
+            next[i] = head[bucket];
+            head[bucket] = static_cast<uint32_t>(i);
+        }
+    }
+
+    template <typename EmitMatch>
+    void probe(int32_t key, EmitMatch&& emitMatch) const {
+        if (titles.empty()) {
+            return;
+        }
+        for (uint32_t entry = head[radixHash(key) & mask]; entry != RADIX_CHAIN_END; entry = next[entry]) {
+            if (titles[entry].titleId == key) {
+                emitMatch(titles[entry]);
+            }
+        }
+    }
+
+  private:
+    std::span<const TitleRelation> titles;
+    std::vector<uint32_t> head;
+    std::vector<uint32_t> next;
+    uint32_t mask = 0;
+};
+
+// Probes a batch of cast tuples in parallel. tableOf(cast) returns the table of the tuple's
+// partition or nullptr to skip it; every thread collects its results and hands full batches
+// to the sink one thread at a time.
+template <typename TableOf>
+void probeCastBatch(std::span<const CastRelation> casts, TableOf&& tableOf, const ResultSink& sink, const GraceJoinOptions& options, GraceJoinStats& stats) {
+    const size_t result_batch_size = std::max<size_t>(options.resultBatchSize, 1);
+    size_t results = 0;
+
+#pragma omp parallel num_threads(options.numThreads) shared(casts, tableOf, sink, result_batch_size) reduction(+ : results)
+    {
+        std::vector<ResultRelation> local;
+        const auto flush = [&]() {
+#pragma omp critical(grace_join_sink)
+            sink(local);
+            results += local.size();
+            local.clear();
+        };
+#pragma omp for schedule(static)
+        for (size_t i = 0; i < casts.size(); ++i) {
+            if (const TitleHashTable* table = tableOf(casts[i])) {
+                table->probe(casts[i].movieId, [&](const TitleRelation& title) {
+                    local.push_back(createResultTuple(casts[i], title));
+                    if (local.size() == result_batch_size) {
+                        flush();
+                    }
+                });
+            }
+        }
+        if (!local.empty()) {
+            flush();
+        }
+    }
+    stats.resultTuples += results;
+}
+
+// Joins two unsorted streams whose title side does not have to fit into memory
+inline GraceJoinStats performGraceHashJoin(const CastBatchReader& castReader, const TitleBatchReader& titleReader, const ResultSink& sink, const GraceJoinOptions& options = {}) {
+    const size_t num_partitions = std::bit_ceil(std::max<size_t>(options.numPartitions, 1));
+    const auto partition_bits = static_cast<unsigned>(std::countr_zero(num_partitions));
+    const size_t batch_size = std::max<size_t>(options.batchSize, 1);
+    // The high hash bits pick the partition, the low ones the bucket inside its hash table
+    const auto partition_of = [partition_bits](int32_t key) -> size_t {
+        return partition_bits == 0 ? 0 : radixHash(key) >> (32 - partition_bits);
+    };
+    GraceJoinStats stats;
+
+    // Build side: partition the titles and spill the largest partitions while over budget
+    std::vector<RelationVector<TitleRelation>> resident(num_partitions);
+    std::vector<std::unique_ptr<SpillFile<TitleRelation>>> title_files(num_partitions);
+    size_t resident_bytes = 0;
+    RelationVector<TitleRelation> title_batch;
+    while (title_batch.clear(), titleReader(title_batch, batch_size) > 0) {
+        stats.titleTuples += title_batch.size();
+        for (const TitleRelation& title : title_batch) {
+            const size_t partition = partition_of(title.titleId);
+            if (title_files[partition]) {
+                title_files[partition]->append(title);
+            } else {
+                resident[partition].push_back(title);
+                resident_bytes += GRACE_BYTES_PER_TITLE;
+            }
+        }
+        while (resident_bytes > options.memoryBudget) {
+            const auto largest = std::ranges::max_element(resident, {}, [](const RelationVector<TitleRelation>& titles) { return titles.size(); });
+            const size_t partition = largest - resident.begin();
+            title_files[partition] = std::make_unique<SpillFile<TitleRelation>>(options.spillDirectory, options.ioBufferSize);
+            title_files[partition]->append(std::span<const TitleRelation>(*largest));
+            resident_bytes -= largest->size() * GRACE_BYTES_PER_TITLE;
+            RelationVector<TitleRelation>().swap(*largest);
+        }
+    }
+
+    std::vector<TitleHashTable> tables(num_partitions);
+    for (size_t partition = 0; partition < num_partitions; ++partition) {
+        if (!title_files[partition]) {
+            tables[partition].build(resident[partition]);
+        }
+    }
+
+    // Probe side: resident partitions are joined right away, the others are written next to their titles
+    std::vector<std::unique_ptr<SpillFile<CastRelation>>> cast_files(num_partitions);
+    RelationVector<CastRelation> cast_batch;
+    while (cast_batch.clear(), castReader(cast_batch, batch_size) > 0) {
+        stats.castTuples += cast_batch.size();
+        for (const CastRelation& cast : cast_batch) {
+            const size_t partition = partition_of(cast.movieId);
+            if (title_files[partition]) {
+                if (!cast_files[partition]) {
+                    cast_files[partition] = std::make_unique<SpillFile<CastRelation>>(options.spillDirectory, options.ioBufferSize);
+                }
+                cast_files[partition]->append(cast);
+            }
+        }
+        probeCastBatch(cast_batch, [&](const CastRelation& cast) -> const TitleHashTable* {
+            const size_t partition = partition_of(cast.movieId);
+            return title_files[partition] ? nullptr : &tables[partition];
+        }, sink, options, stats);
+    }
+    resident.clear();
+    tables.clear();
+
+    // Spilled partitions are joined one at a time, so only one of them is in memory
+    for (size_t partition = 0; partition < num_partitions; ++partition) {
+        if (!title_files[partition]) {
+            stats.residentPartitions++;
+            continue;
+        }
+        stats.spilledPartitions++;
+        RelationVector<TitleRelation> titles;
+        title_files[partition]->readBack([&](std::span<const TitleRelation> chunk) {
+            titles.insert(titles.end(), chunk.begin(), chunk.end());
+        });
+        stats.bytesSpilled += title_files[partition]->bytesWritten();
+        stats.bytesReadBack += title_files[partition]->bytesWritten();
+        title_files[partition].reset();
+        if (titles.size() * GRACE_BYTES_PER_TITLE > options.memoryBudget) {
+            std::cerr << "Warning: Spilled partition " << partition << " exceeds the memory budget" << std::endl;
+        }
+
+        if (cast_files[partition]) {
+            TitleHashTable table;
+            table.build(titles);
+            cast_files[partition]->readBack([&](std::span<const CastRelation> chunk) {
+                probeCastBatch(chunk, [&](const CastRelation&) { return &table; }, sink, options, stats);
+            });
+            stats.bytesSpilled += cast_files[partition]->bytesWritten();
+            stats.bytesReadBack += cast_files[partition]->bytesWritten();
+            cast_files[partition].reset();
+        }
+    }
+
+    return stats;
+}
+
+#endif // GRACEHASHJOIN_HPP
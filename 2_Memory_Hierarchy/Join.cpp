@@ -1,179 +1,1790 @@
-#include "JoinUtils.hpp"
+#include "Join.hpp"
+#include "CacheInfo.hpp"
+#include "DirectAddressJoin.hpp"
+#include "GraceHashJoin.hpp"
+#include "JoinAggregation.hpp"
+#include "NumaPlacement.hpp"
+#include "PerfCounters.hpp"
+#include "ParallelSort.hpp"
+#include "RadixHashJoin.hpp"
+#include "RelationSnapshot.hpp"
+#include "SemiJoinFilter.hpp"
+#include "SimdMergeJoin.hpp"
+#include "WorkStealing.hpp"
 #include <gtest/gtest.h>
 #include <omp.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <ranges>
 #include <vector>
 #include <iostream>
 #include <string>
+#include <tuple>
 #include <chrono>
 #include <cmath>
+#include <numeric>
+#include <optional>
 using namespace std;
 
+// A partition with this many times the chunk size of cast tuples contains a heavy hitter run
+static constexpr size_t SKEW_SPLIT_FACTOR = 2;
+// Result tuples one work-stealing task materializes before it checks for thieves
+static constexpr size_t MATERIALIZE_GRAIN = 1024;
 
-int splitTitle(const vector<TitleRelation>& titleRelation, int index_of_cutoff) {
-    if (index_of_cutoff < 0 || index_of_cutoff >= static_cast<int>(titleRelation.size()))
-        return 0;
+// The partitioners and the merge kernel only look at the join keys. For row relations the
+// keys are a strided view over the tuples, for columnar relations they are the key column.
+static auto castKeys(span<const CastRelation> castRelation) {
+    return views::transform(castRelation, &CastRelation::movieId);
+}
+
+static auto titleKeys(span<const TitleRelation> titleRelation) {
+    return views::transform(titleRelation, &TitleRelation::titleId);
+}
+
+static span<const int32_t> castKeys(const CastColumns& castRelation) {
+    return castRelation.movieId;
+}
+
+static span<const int32_t> titleKeys(const TitleColumns& titleRelation) {
+    return titleRelation.titleId;
+}
+
+// Key order that is already known, e.g. from the header of a snapshot. Keys known to be sorted
+// skip the sortedness scan.
+struct KnownKeyOrder {
+    bool castSorted = false;
+    bool titleSorted = false;
+};
+
+static KnownKeyOrder knownKeyOrder(span<const CastRelation>, span<const TitleRelation>) {
+    return {};
+}
+
+static KnownKeyOrder knownKeyOrder(const CastColumns& castRelation, const TitleColumns& titleRelation) {
+    return {castRelation.sortedByKey, titleRelation.sortedByKey};
+}
+
+static ResultRelation createResultTuple(span<const CastRelation> castRelation, size_t cast_index, span<const TitleRelation> titleRelation, size_t title_index) {
+    return createResultTuple(castRelation[cast_index], titleRelation[title_index]);
+}
 
-    int current_id = titleRelation[index_of_cutoff].titleId;
-    int current_index = index_of_cutoff;
+// Moves a cast cutoff back to the first tuple of its movieId run, so a run is never split
+template <typename CastKeys>
+size_t splitCast(const CastKeys& castKeys, size_t index_of_cutoff) {
+    int current_id = castKeys[index_of_cutoff];
+    while (index_of_cutoff > 0 && castKeys[index_of_cutoff - 1] == current_id) {
+        index_of_cutoff--;
+    }
+    return index_of_cutoff;
+}
 
-    if (current_index + 1 < static_cast<int>(titleRelation.size()) &&
-        titleRelation[current_index + 1].titleId != current_id) {
-        while (current_index > 0 && titleRelation[current_index - 1].titleId == current_id) {
-            current_index--;
+// Moves a cast cutoff forward behind the end of its movieId run
+template <typename CastKeys>
+size_t skipCastRun(const CastKeys& castKeys, size_t index_of_cutoff) {
+    int current_id = castKeys[index_of_cutoff];
+    while (index_of_cutoff < castKeys.size() && castKeys[index_of_cutoff] == current_id) {
+        index_of_cutoff++;
+    }
+    return index_of_cutoff;
+}
+
+// Walks forward through the title keys to the first title that is not smaller than movieId
+template <typename TitleKeys>
+size_t advanceTitle(const TitleKeys& titleKeys, int movieId, size_t title_offset) {
+    while (title_offset < titleKeys.size() && titleKeys[title_offset] < movieId) {
+        title_offset++;
+    }
+    return title_offset;
+}
+
+// Cuts both relations into index ranges of roughly castChunkSize cast tuples without copying them
+template <typename CastKeys, typename TitleKeys>
+vector<JoinPartition> partitionKeys(const CastKeys& castKeys, const TitleKeys& titleKeys, size_t castChunkSize) {
+    vector<JoinPartition> partitions;
+    castChunkSize = std::max<size_t>(castChunkSize, 1);
+
+    size_t cast_offset = 0;
+    size_t title_offset = 0;
+    while (cast_offset + castChunkSize < castKeys.size()) {
+        size_t cast_cutoff = splitCast(castKeys, cast_offset + castChunkSize);
+        if (cast_cutoff <= cast_offset) {
+            // A single movieId run is larger than a chunk, so it becomes a chunk of its own
+            cast_cutoff = skipCastRun(castKeys, cast_offset);
+            if (cast_cutoff == castKeys.size()) {
+                break;
+            }
         }
+        size_t title_cutoff = advanceTitle(titleKeys, castKeys[cast_cutoff], title_offset);
+
+        partitions.push_back({cast_offset, cast_cutoff, title_offset, title_cutoff});
+
+        cast_offset = cast_cutoff;
+        title_offset = title_cutoff;
     }
 
-    return current_index;
+    partitions.push_back({cast_offset, castKeys.size(), title_offset, titleKeys.size()});
+    return partitions;
 }
 
-// Safely walks backward through titleRelation to find cutoff
-int backTitle(const vector<TitleRelation>& titleRelation, int movieId, int index_of_cutoff) {
-    int current_index = index_of_cutoff;
-    while (current_index > 0 && titleRelation[current_index].titleId > movieId) {
-        current_index--;
+// Picks one movieId splitter per chunk and locates every boundary with a binary search.
+// The input is sorted, so evenly spaced samples are exact quantiles of the cast keys.
+template <typename CastKeys, typename TitleKeys>
+vector<JoinPartition> partitionKeysBySplitters(const CastKeys& castKeys, const TitleKeys& titleKeys, size_t castChunkSize, int numThreads) {
+    castChunkSize = std::max<size_t>(castChunkSize, 1);
+    const size_t num_chunks = (castKeys.size() + castChunkSize - 1) / castChunkSize;
+
+    vector<int> splitters;
+    splitters.reserve(num_chunks);
+    for (size_t i = 1; i < num_chunks; ++i) {
+        int splitter = castKeys[i * castKeys.size() / num_chunks];
+        if (splitter > castKeys[0] && (splitters.empty() || splitters.back() != splitter)) {
+            splitters.push_back(splitter);
+        }
     }
-    return current_index;
+
+    vector<JoinPartition> partitions(splitters.size() + 1);
+    partitions.front().castBegin = 0;
+    partitions.front().titleBegin = 0;
+    partitions.back().castEnd = castKeys.size();
+    partitions.back().titleEnd = titleKeys.size();
+
+#pragma omp parallel for num_threads(numThreads) shared(castKeys, titleKeys, splitters, partitions)
+    for (int i = 0; i < static_cast<int>(splitters.size()); ++i) {
+        auto cast_cutoff = std::ranges::lower_bound(castKeys, splitters[i]);
+        auto title_cutoff = std::ranges::lower_bound(titleKeys, splitters[i]);
+        partitions[i].castEnd = partitions[i + 1].castBegin = cast_cutoff - castKeys.begin();
+        partitions[i].titleEnd = partitions[i + 1].titleBegin = title_cutoff - titleKeys.begin();
+    }
+
+    return partitions;
 }
 
-// Safely splits castRelation vector at cutoff index
-int splitCast(const vector<CastRelation>& castRelation, int index_of_cutoff) {
-    if (index_of_cutoff < 0 || index_of_cutoff >= static_cast<int>(castRelation.size()))
-        return 0;
+vector<JoinPartition> partitionRelations(const RelationVector<CastRelation>& castRelation, const RelationVector<TitleRelation>& titleRelation, size_t castChunkSize) {
+    return partitionKeys(castKeys(castRelation), titleKeys(titleRelation), castChunkSize);
+}
 
-    int current_id = castRelation[index_of_cutoff].movieId;
-    int current_index = index_of_cutoff;
+vector<JoinPartition> partitionRelationsBySplitters(const RelationVector<CastRelation>& castRelation, const RelationVector<TitleRelation>& titleRelation, size_t castChunkSize, int numThreads) {
+    return partitionKeysBySplitters(castKeys(castRelation), titleKeys(titleRelation), castChunkSize, numThreads);
+}
+
+// Merges the key ranges of one partition and calls emitRun(cast_begin, cast_end, title_index)
+// for every run of cast tuples that matches one title tuple. All indices are absolute.
+template <typename CastKeys, typename TitleKeys, typename EmitRun>
+void mergeJoinThread(const CastKeys& castKeys, const TitleKeys& titleKeys, const JoinPartition& partition, EmitRun&& emitRun) {
+    size_t pointer_cast = partition.castBegin;
+    size_t pointer_title = partition.titleBegin;
 
-    if (current_index + 1 < static_cast<int>(castRelation.size()) &&
-        castRelation[current_index + 1].movieId != current_id) {
-        while (current_index > 0 && castRelation[current_index - 1].movieId == current_id) {
-            current_index--;
+    while (pointer_cast < partition.castEnd && pointer_title < partition.titleEnd) {
+        if (castKeys[pointer_cast] < titleKeys[pointer_title]) {
+            pointer_cast++;
+        } else if (castKeys[pointer_cast] > titleKeys[pointer_title]) {
+            pointer_title++;
+        } else {
+            size_t run_end = pointer_cast;
+            while (run_end < partition.castEnd && castKeys[run_end] == titleKeys[pointer_title]) {
+                run_end++;
+            }
+            emitRun(pointer_cast, run_end, pointer_title);
+            pointer_title++;
         }
     }
+}
+
+// Contiguous int32 key columns take the SIMD kernel picked via CPUID
+template <typename EmitRun>
+void mergeJoinThread(span<const int32_t> castKeys, span<const int32_t> titleKeys, const JoinPartition& partition, EmitRun&& emitRun) {
+    mergeJoinKeys(detectSimdLevel(), castKeys.data(), partition.castBegin, partition.castEnd,
+                  titleKeys.data(), partition.titleBegin, partition.titleEnd, emitRun);
+}
 
-    return current_index;
+// Counts the result tuples of one partition
+template <typename CastKeys, typename TitleKeys>
+size_t countPartition(const CastKeys& castKeys, const TitleKeys& titleKeys, const JoinPartition& partition) {
+    size_t count = 0;
+    mergeJoinThread(castKeys, titleKeys, partition, [&](size_t cast_begin, size_t cast_end, size_t) {
+        count += cast_end - cast_begin;
+    });
+    return count;
+}
+
+// Joins one partition and writes the result tuples to output. Payloads are only read here.
+template <typename CastInput, typename TitleInput>
+size_t materializePartition(const CastInput& castRelation, const TitleInput& titleRelation, const JoinPartition& partition, ResultRelation* output) {
+    size_t count = 0;
+    mergeJoinThread(castKeys(castRelation), titleKeys(titleRelation), partition, [&](size_t cast_begin, size_t cast_end, size_t title_index) {
+        for (size_t i = cast_begin; i < cast_end; ++i) {
+            output[count++] = createResultTuple(castRelation, i, titleRelation, title_index);
+        }
+    });
+    return count;
 }
 
-// Safely walks backward through castRelation to find cutoff
-int backCast(const vector<CastRelation>& castRelation, int titleId, int index_of_cutoff) {
-    int current_index = index_of_cutoff;
-    while (current_index > 0 && castRelation[current_index].movieId > titleId) {
-        current_index--;
+// Writes the row ids of all matches of one partition to output
+template <typename CastKeys, typename TitleKeys>
+size_t writeIndexPairsPartition(const CastKeys& castKeys, const TitleKeys& titleKeys, const JoinPartition& partition, JoinIndexPair* output) {
+    size_t count = 0;
+    mergeJoinThread(castKeys, titleKeys, partition, [&](size_t cast_begin, size_t cast_end, size_t title_index) {
+        for (size_t i = cast_begin; i < cast_end; ++i) {
+            output[count++] = {static_cast<uint32_t>(i), static_cast<uint32_t>(title_index)};
+        }
+    });
+    return count;
+}
+
+// Columnar index join: runs are written as whole vectors of pairs when AVX2 is available
+size_t writeIndexPairsPartition(span<const int32_t> castKeys, span<const int32_t> titleKeys, const JoinPartition& partition, JoinIndexPair* output) {
+#ifdef PPDS_SIMD_X86
+    if (detectSimdLevel() != SimdLevel::Scalar) {
+        static_assert(sizeof(JoinIndexPair) == sizeof(uint64_t) && offsetof(JoinIndexPair, titleIndex) == sizeof(uint32_t));
+        size_t count = 0;
+        mergeJoinThread(castKeys, titleKeys, partition, [&](size_t cast_begin, size_t cast_end, size_t title_index) {
+            writeIndexRunAvx2(output + count, cast_begin, cast_end, title_index);
+            count += cast_end - cast_begin;
+        });
+        return count;
     }
-    return current_index;
+#endif
+    return writeIndexPairsPartition<span<const int32_t>, span<const int32_t>>(castKeys, titleKeys, partition, output);
 }
 
-// Determines how to slice castRelation and titleRelation at a cutoff point
-vector<int> splitRelations(const vector<CastRelation>& castRelation, const vector<TitleRelation>& titleRelation, int cast_index_of_cutoff, int title_index_of_cutoff) {
-    if (castRelation.empty() || titleRelation.empty() ||
-        cast_index_of_cutoff >= static_cast<int>(castRelation.size()) ||
-        title_index_of_cutoff >= static_cast<int>(titleRelation.size())) {
-        return {0, 0};
+// Counts the result tuples of two slices of cast/title relation
+size_t countJoinThread(span<const CastRelation> castRelation, span<const TitleRelation> titleRelation) {
+    return countPartition(castKeys(castRelation), titleKeys(titleRelation), {0, castRelation.size(), 0, titleRelation.size()});
+}
+
+// Performs join on two slices of cast/title relation and writes the result tuples to output
+size_t performJoinThread(span<const CastRelation> castRelation, span<const TitleRelation> titleRelation, ResultRelation* output) {
+    return materializePartition(castRelation, titleRelation, {0, castRelation.size(), 0, titleRelation.size()}, output);
+}
+
+// Cast bytes the join touches per tuple: the merge over rows pulls in one cache line per key,
+// materializing from rows reads the whole row, and key columns are read densely
+static size_t rowKeyBytesPerTuple() {
+    return std::min(sizeof(CastRelation), cacheSizes().lineSize);
+}
+static constexpr size_t ROW_BYTES_PER_TUPLE = sizeof(CastRelation);
+static constexpr size_t COLUMN_KEY_BYTES_PER_TUPLE = sizeof(int32_t);
+// Automatic chunks are cut small enough to give every thread a few partitions
+static constexpr size_t MIN_PARTITIONS_PER_THREAD = 4;
+
+// Number of cast tuples per partition. Unless the options fix it, it is sized so that the bytes
+// the join touches per partition fill half of the detected L2 cache.
+static size_t castChunkSize(const JoinOptions& options, size_t bytesPerTuple, size_t castSize, int numThreads) {
+    if (options.castChunkSize != 0) {
+        return options.castChunkSize;
+    }
+    const size_t by_cache = cacheSizes().l2 / 2 / std::max<size_t>(bytesPerTuple, 1);
+    const size_t by_threads = castSize / (static_cast<size_t>(std::max(numThreads, 1)) * MIN_PARTITIONS_PER_THREAD);
+    return std::max<size_t>(std::min(by_cache, std::max<size_t>(by_threads, 1)), 1);
+}
+
+// Re-cuts partitions with more than SKEW_SPLIT_FACTOR * castChunkSize cast tuples. Their key runs
+// are regrouped into partitions of about castChunkSize cast tuples, and a heavy hitter run that is
+// larger than a chunk on its own is spread over several partitions that all join the same titles.
+template <typename CastKeys, typename TitleKeys>
+vector<JoinPartition> splitSkewedPartitions(const CastKeys& castKeys, const TitleKeys& titleKeys, const vector<JoinPartition>& partitions, size_t castChunkSize) {
+    castChunkSize = std::max<size_t>(castChunkSize, 1);
+    vector<JoinPartition> balanced;
+    balanced.reserve(partitions.size());
+
+    for (const JoinPartition& partition : partitions) {
+        if (partition.castEnd - partition.castBegin <= SKEW_SPLIT_FACTOR * castChunkSize) {
+            balanced.push_back(partition);
+            continue;
         }
 
-    int title_id = titleRelation[title_index_of_cutoff].titleId;
-    int cast_id = castRelation[cast_index_of_cutoff].movieId;
+        const auto cast_begin = castKeys.begin();
+        const auto title_begin = titleKeys.begin();
+        JoinPartition group{partition.castBegin, partition.castBegin, partition.titleBegin, partition.titleBegin};
+        size_t title_offset = partition.titleBegin;
+        for (size_t cast_offset = partition.castBegin; cast_offset < partition.castEnd;) {
+            const int key = castKeys[cast_offset];
+            const size_t run_end = std::upper_bound(cast_begin + cast_offset, cast_begin + partition.castEnd, key) - cast_begin;
+            const size_t key_titles_begin = std::lower_bound(title_begin + title_offset, title_begin + partition.titleEnd, key) - title_begin;
+            const size_t key_titles_end = std::upper_bound(title_begin + key_titles_begin, title_begin + partition.titleEnd, key) - title_begin;
+
+            if (run_end - cast_offset > castChunkSize) {
+                // Heavy hitter: close the open group and let several tasks share the run
+                if (group.castEnd > group.castBegin) {
+                    group.titleEnd = key_titles_begin;
+                    balanced.push_back(group);
+                }
+                for (size_t piece = cast_offset; piece < run_end; piece += castChunkSize) {
+                    balanced.push_back({piece, std::min(piece + castChunkSize, run_end), key_titles_begin, key_titles_end});
+                }
+                group = {run_end, run_end, key_titles_end, key_titles_end};
+            } else {
+                if (group.castEnd > group.castBegin && group.castEnd - group.castBegin + run_end - cast_offset > castChunkSize) {
+                    group.titleEnd = key_titles_begin;
+                    balanced.push_back(group);
+                    group = {cast_offset, cast_offset, key_titles_begin, key_titles_begin};
+                }
+                group.castEnd = run_end;
+            }
+            cast_offset = run_end;
+            title_offset = key_titles_end;
+        }
+        group.titleEnd = partition.titleEnd;
+        if (group.castEnd > group.castBegin) {
+            balanced.push_back(group);
+        }
+    }
+    return balanced;
+}
+
+template <typename CastKeys, typename TitleKeys>
+static vector<JoinPartition> partitionForJoin(const CastKeys& castKeys, const TitleKeys& titleKeys, size_t index_of_cutoff, int numThreads, const JoinOptions& options) {
+    const vector<JoinPartition> partitions = options.partitionStrategy == PartitionStrategy::KeySplitters
+                                                 ? partitionKeysBySplitters(castKeys, titleKeys, index_of_cutoff, numThreads)
+                                                 : partitionKeys(castKeys, titleKeys, index_of_cutoff);
+    return options.splitHeavyHitters ? splitSkewedPartitions(castKeys, titleKeys, partitions, index_of_cutoff) : partitions;
+}
 
-    if (title_id > cast_id) {
-        int title_index = splitTitle(titleRelation, title_index_of_cutoff);
-        int cast_index = backCast(castRelation, titleRelation[title_index].titleId, cast_index_of_cutoff);
-        return {static_cast<int>(title_index), static_cast<int>(cast_index)};
+// Calls body(i) for every i in [0, size): on the work-stealing executor of the options if there
+// is one, otherwise with a dynamically scheduled OpenMP loop. grain only applies to the executor.
+template <typename Body>
+static void parallelForEach(size_t size, size_t grain, int numThreads, const JoinOptions& options, Body&& body) {
+    if (options.executor != nullptr) {
+        options.executor->parallelFor(size, grain, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                body(i);
+            }
+        });
+        return;
+    }
+
+#pragma omp parallel for schedule(dynamic) num_threads(numThreads) shared(body)
+    for (size_t i = 0; i < size; ++i) {
+        body(i);
+    }
+}
+
+// Runs one join phase and returns its result. With a profile in the options, the phase is
+// recorded there under name with the counters of every thread of the team that runs it.
+template <typename Body>
+static auto profilePhase(const char* name, int numThreads, const JoinOptions& options, Body&& body) {
+    if (options.profile == nullptr) {
+        return body();
+    }
+    options.profile->beginPhase(name, options.executor != nullptr ? options.executor->numThreads() : numThreads);
+    if constexpr (std::is_void_v<decltype(body())>) {
+        body();
+        options.profile->endPhase();
     } else {
-        int cast_index = splitCast(castRelation, cast_index_of_cutoff);
-        int title_index = backTitle(titleRelation, castRelation[cast_index].movieId, title_index_of_cutoff);
-        return {static_cast<int>(title_index), static_cast<int>(cast_index)};
+        auto result = body();
+        options.profile->endPhase();
+        return result;
     }
 }
 
-// Performs join on two slices of cast/title relation
-vector<ResultRelation> performJoinThread(const vector<CastRelation>& castRelation, const vector<TitleRelation>& titleRelation) {
-    vector<ResultRelation> resultTuples;
-    int pointer_cast = 0;
-    int pointer_title = 0;
-    int old_position = 0;
+// NUMA mode of the partition loop: every thread takes a contiguous block of partitions, pins
+// itself to a CPU of its node and then calls body(i) for its partitions. The output slots are
+// not initialized, so body is their first touch and the kernel allocates each block of slots on
+// the node of its thread; nothing is migrated or bound. The inputs are interleaved over the nodes
+// by the loader (interleaveRows). The thread affinity is restored at the end.
+template <typename Body>
+static void forEachPartitionOnNodes(const vector<JoinPartition>& partitions, int numThreads, Body&& body) {
+#pragma omp parallel num_threads(numThreads) shared(partitions, body)
+    {
+        const int thread = omp_get_thread_num();
+        const int team = omp_get_num_threads();
+        cpu_set_t previous_affinity;
+        const bool restore = sched_getaffinity(0, sizeof(previous_affinity), &previous_affinity) == 0;
+        pinThreadToNode(thread, team);
 
-    while (pointer_cast < static_cast<int>(castRelation.size()) && pointer_title < static_cast<int> (titleRelation.size())) {
-        if (castRelation[pointer_cast].movieId < titleRelation[pointer_title].titleId) {
-            pointer_cast++;
-        } else if (castRelation[pointer_cast].movieId > titleRelation[pointer_title].titleId) {
-            pointer_title++;
-        } else {
-            old_position = pointer_cast;
-            while (pointer_cast < castRelation.size() &&
-                   castRelation[pointer_cast].movieId == titleRelation[pointer_title].titleId) {
-                resultTuples.push_back(createResultTuple(castRelation[pointer_cast], titleRelation[pointer_title]));
-                pointer_cast++;
+        const size_t first = thread * partitions.size() / team;
+        const size_t last = (thread + 1) * partitions.size() / team;
+        for (size_t i = first; i < last; ++i) {
+            body(i);
+        }
+
+        if (restore) {
+            sched_setaffinity(0, sizeof(previous_affinity), &previous_affinity);
+        }
+    }
+}
+
+// Counts the result tuples per partition, so every partition knows its output slot.
+// Returns the exclusive prefix sum with the total number of results as last element.
+template <typename CastKeys, typename TitleKeys>
+static vector<size_t> computeOutputOffsets(const vector<JoinPartition>& partitions, const CastKeys& castKeys, const TitleKeys& titleKeys, int numThreads, const JoinOptions& options) {
+    vector<size_t> output_offsets(partitions.size() + 1, 0);
+
+    parallelForEach(partitions.size(), 1, numThreads, options, [&](size_t i) {
+        output_offsets[i + 1] = countPartition(castKeys, titleKeys, partitions[i]);
+    });
+
+    std::partial_sum(output_offsets.begin(), output_offsets.end(), output_offsets.begin());
+    return output_offsets;
+}
+
+template <typename CastKeys, typename TitleKeys>
+static bool fitsRowIds(const CastKeys& castKeys, const TitleKeys& titleKeys) {
+    if (castKeys.size() > UINT32_MAX || titleKeys.size() > UINT32_MAX) {
+        std::cerr << "Error: Relations with more than 2^32 tuples cannot be addressed by 32 bit row ids" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Builds the result tuples of a row id join result in parallel
+template <typename CastInput, typename TitleInput>
+static ResultVector materializeIndexPairs(const CastInput& castRelation, const TitleInput& titleRelation, const JoinIndexVector& indexPairs, int numThreads, const JoinOptions& options) {
+    ResultVector resultRelation(indexPairs.size());
+
+    if (options.executor != nullptr) {
+        options.executor->parallelFor(indexPairs.size(), MATERIALIZE_GRAIN, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                resultRelation[i] = createResultTuple(castRelation, indexPairs[i].castIndex, titleRelation, indexPairs[i].titleIndex);
             }
-            pointer_cast = old_position;
-            pointer_title++;
+        });
+        return resultRelation;
+    }
+
+#pragma omp parallel for schedule(static) num_threads(numThreads) default(none) shared(castRelation, titleRelation, indexPairs, resultRelation)
+    for (size_t i = 0; i < indexPairs.size(); ++i) {
+        resultRelation[i] = createResultTuple(castRelation, indexPairs[i].castIndex, titleRelation, indexPairs[i].titleIndex);
+    }
+
+    return resultRelation;
+}
+
+// Sort-merge join of relations that are not sorted by their join key: sorts the (key, row id)
+// pairs of both sides and merges those, so the fat tuples are never moved
+template <typename CastKeys, typename TitleKeys>
+static JoinIndexVector performSortingIndexJoin(const CastKeys& castKeys, bool castSorted, const TitleKeys& titleKeys, bool titleSorted, size_t index_of_cutoff, int numThreads, const JoinOptions& options) {
+    const auto [sorted_cast, sorted_title] = profilePhase("sort", numThreads, options, [&] {
+        return std::make_pair(sortKeyRows(castKeys, castSorted, numThreads), sortKeyRows(titleKeys, titleSorted, numThreads));
+    });
+    const auto sorted_cast_keys = views::transform(sorted_cast, &RadixTuple::key);
+    const auto sorted_title_keys = views::transform(sorted_title, &RadixTuple::key);
+
+    const vector<JoinPartition> partitions = profilePhase("partition", numThreads, options, [&] {
+        return partitionForJoin(sorted_cast_keys, sorted_title_keys, index_of_cutoff, numThreads, options);
+    });
+    const vector<size_t> output_offsets = profilePhase("count", numThreads, options, [&] {
+        return computeOutputOffsets(partitions, sorted_cast_keys, sorted_title_keys, numThreads, options);
+    });
+
+    JoinIndexVector indexPairs = profilePhase("allocate", numThreads, options, [&] { return JoinIndexVector(output_offsets.back()); });
+
+    profilePhase("join", numThreads, options, [&] {
+        parallelForEach(partitions.size(), 1, numThreads, options, [&](size_t i) {
+            JoinIndexPair* output = indexPairs.data() + output_offsets[i];
+            mergeJoinThread(sorted_cast_keys, sorted_title_keys, partitions[i], [&](size_t cast_begin, size_t cast_end, size_t title_index) {
+                for (size_t j = cast_begin; j < cast_end; ++j) {
+                    *output++ = {sorted_cast[j].row, sorted_title[title_index].row};
+                }
+            });
+        });
+    });
+
+    return indexPairs;
+}
+
+// Direct address join if the titleIds are unique and dense, nothing otherwise
+template <typename CastKeys, typename TitleKeys>
+static std::optional<JoinIndexVector> performDirectAddressJoin(const CastKeys& castKeys, const TitleKeys& titleKeys, int numThreads, const JoinOptions& options) {
+    const std::optional<DirectAddressTable> table = profilePhase("build", numThreads, options, [&] {
+        return buildDirectAddressTable(titleKeys, numThreads);
+    });
+    if (!table) {
+        return std::nullopt;
+    }
+    return profilePhase("probe", numThreads, options, [&] { return probeDirectAddressTable(*table, castKeys, numThreads); });
+}
+
+template <typename CastInput, typename TitleInput>
+static ResultVector performMaterializedJoin(const CastInput& castRelation, const TitleInput& titleRelation, size_t index_of_cutoff, int numThreads, const JoinOptions& options) {
+    if (options.algorithm == JoinAlgorithm::RadixHash) {
+        if (!fitsRowIds(castKeys(castRelation), titleKeys(titleRelation))) {
+            return {};
+        }
+        const JoinIndexVector indexPairs = profilePhase("radix join", numThreads, options, [&] {
+            return radixHashJoin(castKeys(castRelation), titleKeys(titleRelation), numThreads);
+        });
+        return profilePhase("materialize", numThreads, options, [&] {
+            return materializeIndexPairs(castRelation, titleRelation, indexPairs, numThreads, options);
+        });
+    }
+    if (options.algorithm == JoinAlgorithm::DirectAddress && fitsRowIds(castKeys(castRelation), titleKeys(titleRelation))) {
+        if (auto indexPairs = performDirectAddressJoin(castKeys(castRelation), titleKeys(titleRelation), numThreads, options)) {
+            return profilePhase("materialize", numThreads, options, [&] {
+                return materializeIndexPairs(castRelation, titleRelation, *indexPairs, numThreads, options);
+            });
         }
     }
 
-    return resultTuples;
+    const KnownKeyOrder order = knownKeyOrder(castRelation, titleRelation);
+    const bool cast_sorted = order.castSorted || isSortedParallel(castKeys(castRelation), numThreads);
+    const bool title_sorted = order.titleSorted || isSortedParallel(titleKeys(titleRelation), numThreads);
+    if (!cast_sorted || !title_sorted) {
+        if (!fitsRowIds(castKeys(castRelation), titleKeys(titleRelation))) {
+            return {};
+        }
+        const JoinIndexVector indexPairs =
+            performSortingIndexJoin(castKeys(castRelation), cast_sorted, titleKeys(titleRelation), title_sorted, index_of_cutoff, numThreads, options);
+        return profilePhase("materialize", numThreads, options, [&] {
+            return materializeIndexPairs(castRelation, titleRelation, indexPairs, numThreads, options);
+        });
+    }
+
+    const vector<JoinPartition> partitions = profilePhase("partition", numThreads, options, [&] {
+        return partitionForJoin(castKeys(castRelation), titleKeys(titleRelation), index_of_cutoff, numThreads, options);
+    });
+    const vector<size_t> output_offsets = profilePhase("count", numThreads, options, [&] {
+        return computeOutputOffsets(partitions, castKeys(castRelation), titleKeys(titleRelation), numThreads, options);
+    });
+
+    // Every partition writes straight into its slot of the preallocated result; the slots are not
+    // initialized, so the materialization is the only pass that writes them
+    ResultVector resultRelation = profilePhase("allocate", numThreads, options, [&] { return ResultVector(output_offsets.back()); });
+
+    // Merging a partition and writing its result tuples is one pass, recorded as one phase
+    const auto join_partition = [&](size_t i) {
+        materializePartition(castRelation, titleRelation, partitions[i], resultRelation.data() + output_offsets[i]);
+    };
+    profilePhase("join materialize", numThreads, options, [&] {
+        if (options.numaAware) {
+            forEachPartitionOnNodes(partitions, numThreads, join_partition);
+        } else {
+            parallelForEach(partitions.size(), 1, numThreads, options, join_partition);
+        }
+    });
+
+    return resultRelation;
 }
 
-vector<ResultRelation> performJoin(const vector<CastRelation>& castRelation, const vector<TitleRelation>& titleRelation, int numThreads) {
-    int half_cache_size_with_padding = 256 * 1024;
+template <typename CastKeys, typename TitleKeys>
+static JoinIndexVector performIndexJoin(const CastKeys& castKeys, const TitleKeys& titleKeys, size_t index_of_cutoff, int numThreads, const JoinOptions& options,
+                                        const KnownKeyOrder& order = {}) {
+    if (!fitsRowIds(castKeys, titleKeys)) {
+        return {};
+    }
+    if (options.algorithm == JoinAlgorithm::RadixHash) {
+        return profilePhase("radix join", numThreads, options, [&] { return radixHashJoin(castKeys, titleKeys, numThreads); });
+    }
+    if (options.algorithm == JoinAlgorithm::DirectAddress) {
+        if (auto indexPairs = performDirectAddressJoin(castKeys, titleKeys, numThreads, options)) {
+            return std::move(*indexPairs);
+        }
+    }
+
+    const bool cast_sorted = order.castSorted || isSortedParallel(castKeys, numThreads);
+    const bool title_sorted = order.titleSorted || isSortedParallel(titleKeys, numThreads);
+    if (!cast_sorted || !title_sorted) {
+        return performSortingIndexJoin(castKeys, cast_sorted, titleKeys, title_sorted, index_of_cutoff, numThreads, options);
+    }
+
+    const vector<JoinPartition> partitions = profilePhase("partition", numThreads, options, [&] {
+        return partitionForJoin(castKeys, titleKeys, index_of_cutoff, numThreads, options);
+    });
+    const vector<size_t> output_offsets = profilePhase("count", numThreads, options, [&] {
+        return computeOutputOffsets(partitions, castKeys, titleKeys, numThreads, options);
+    });
+
+    JoinIndexVector indexPairs = profilePhase("allocate", numThreads, options, [&] { return JoinIndexVector(output_offsets.back()); });
+
+    profilePhase("join", numThreads, options, [&] {
+        parallelForEach(partitions.size(), 1, numThreads, options, [&](size_t i) {
+            writeIndexPairsPartition(castKeys, titleKeys, partitions[i], indexPairs.data() + output_offsets[i]);
+        });
+    });
+
+    return indexPairs;
+}
+
+// Joins only the tuples of the larger relation that pass a semi-join filter over the keys of the
+// smaller one. The join runs on the dense keys of the passed tuples; its row ids are mapped back
+// to the input afterwards. Filtering keeps the key order.
+template <typename CastKeys, typename TitleKeys>
+static JoinIndexVector performPrefilteredIndexJoin(const CastKeys& castKeys, const TitleKeys& titleKeys, size_t index_of_cutoff, int numThreads, const JoinOptions& options,
+                                                   const KnownKeyOrder& order = {}) {
+    if (!fitsRowIds(castKeys, titleKeys)) {
+        return {};
+    }
+    JoinOptions join_options = options;
+    join_options.prefilter = SemiJoinPrefilter::None;
+    const bool filter_cast = castKeys.size() >= titleKeys.size();
+
+    PrefilterStats stats;
+    stats.castFiltered = filter_cast;
+    stats.inputTuples = filter_cast ? castKeys.size() : titleKeys.size();
+    const FilteredRows passed = profilePhase("prefilter", numThreads, options, [&] {
+        const SemiJoinFilter filter = filter_cast ? SemiJoinFilter::build(titleKeys, options.prefilter, numThreads)
+                                                  : SemiJoinFilter::build(castKeys, options.prefilter, numThreads);
+        stats.filter = filter.getKind();
+        stats.filterBytes = filter.sizeBytes();
+        return filter_cast ? filterRows(castKeys, filter, numThreads) : filterRows(titleKeys, filter, numThreads);
+    });
+    stats.passedTuples = passed.rows.size();
+
+    JoinIndexVector indexPairs;
+    if (filter_cast) {
+        indexPairs = performIndexJoin(passed.keys, titleKeys, index_of_cutoff, numThreads, join_options, order);
+    } else {
+        indexPairs = performIndexJoin(castKeys, passed.keys, index_of_cutoff, numThreads, join_options, order);
+    }
+
+    // A passed tuple that ends up without a match is a false positive of the filter
+    if (options.prefilterStats != nullptr) {
+        vector<bool> matched(passed.rows.size(), false);
+        for (const JoinIndexPair& pair : indexPairs) {
+            matched[filter_cast ? pair.castIndex : pair.titleIndex] = true;
+        }
+        stats.matchingTuples = static_cast<size_t>(std::count(matched.begin(), matched.end(), true));
+        *options.prefilterStats = stats;
+    }
+
+#pragma omp parallel for schedule(static) num_threads(numThreads) shared(indexPairs, passed, filter_cast)
+    for (size_t i = 0; i < indexPairs.size(); ++i) {
+        uint32_t& row = filter_cast ? indexPairs[i].castIndex : indexPairs[i].titleIndex;
+        row = passed.rows[row];
+    }
+    return indexPairs;
+}
+
+// Entry point of the materializing joins; runs the prefiltered index join if one is requested
+template <typename CastInput, typename TitleInput>
+static ResultVector performJoinWithPrefilter(const CastInput& castRelation, const TitleInput& titleRelation, size_t index_of_cutoff, int numThreads, const JoinOptions& options) {
+    if (options.prefilter == SemiJoinPrefilter::None) {
+        return performMaterializedJoin(castRelation, titleRelation, index_of_cutoff, numThreads, options);
+    }
+    const JoinIndexVector indexPairs =
+        performPrefilteredIndexJoin(castKeys(castRelation), titleKeys(titleRelation), index_of_cutoff, numThreads, options, knownKeyOrder(castRelation, titleRelation));
+    return profilePhase("materialize", numThreads, options, [&] {
+        return materializeIndexPairs(castRelation, titleRelation, indexPairs, numThreads, options);
+    });
+}
+
+template <typename CastKeys, typename TitleKeys>
+static JoinIndexVector performIndexJoinWithPrefilter(const CastKeys& castKeys, const TitleKeys& titleKeys, size_t index_of_cutoff, int numThreads, const JoinOptions& options,
+                                                     const KnownKeyOrder& order = {}) {
+    if (options.prefilter == SemiJoinPrefilter::None) {
+        return performIndexJoin(castKeys, titleKeys, index_of_cutoff, numThreads, options, order);
+    }
+    return performPrefilteredIndexJoin(castKeys, titleKeys, index_of_cutoff, numThreads, options, order);
+}
+
+ResultVector performJoin(const RelationVector<CastRelation>& castRelation, const RelationVector<TitleRelation>& titleRelation, int numThreads, const JoinOptions& options) {
+    if (castRelation.empty() || titleRelation.empty()) {
+        printf("Size is empty!");
+        return {};
+    }
+
+    return performJoinWithPrefilter(span<const CastRelation>(castRelation), span<const TitleRelation>(titleRelation),
+                                    castChunkSize(options, ROW_BYTES_PER_TUPLE, castRelation.size(), numThreads), numThreads, options);
+}
 
-    if (castRelation.empty()) {
+ResultVector performJoin(const CastColumns& castRelation, const TitleColumns& titleRelation, int numThreads, const JoinOptions& options) {
+    if (castRelation.empty() || titleRelation.empty()) {
         printf("Size is empty!");
         return {};
     }
-    int index_of_cutoff = half_cache_size_with_padding / static_cast<int>(sizeof(castRelation[0]));
 
-    vector<vector<CastRelation>> castSlices;
-    vector<vector<TitleRelation>> titleSlices;
-    vector<ResultRelation> resultRelation;
+    return performJoinWithPrefilter(castRelation, titleRelation, castChunkSize(options, COLUMN_KEY_BYTES_PER_TUPLE, castRelation.size(), numThreads), numThreads, options);
+}
 
-    int title_offset = 0;
-    int cast_offset = 0;
-    while (castRelation.size() > cast_offset + index_of_cutoff &&
-           titleRelation.size() > title_offset + index_of_cutoff) {
+JoinResultView performLateMaterializedJoin(const RelationVector<CastRelation>& castRelation, const RelationVector<TitleRelation>& titleRelation, int numThreads, const JoinOptions& options) {
+    if (castRelation.empty() || titleRelation.empty()) {
+        printf("Size is empty!");
+        return {castRelation, titleRelation, {}};
+    }
 
-        vector<int> splitIndices = splitRelations(castRelation, titleRelation, index_of_cutoff + cast_offset, index_of_cutoff + title_offset);
-        int title_cutoff = splitIndices[0];
-        int cast_cutoff  = splitIndices[1];
+    return {castRelation, titleRelation,
+            performIndexJoinWithPrefilter(castKeys(castRelation), titleKeys(titleRelation), castChunkSize(options, rowKeyBytesPerTuple(), castRelation.size(), numThreads), numThreads, options)};
+}
 
-        auto cast_end = std::min(castRelation.size(), static_cast<size_t>(cast_cutoff));
-        auto title_end = std::min(titleRelation.size(), static_cast<size_t>(title_cutoff));
+JoinIndexVector performJoinIndices(const CastColumns& castRelation, const TitleColumns& titleRelation, int numThreads, const JoinOptions& options) {
+    if (castRelation.empty() || titleRelation.empty()) {
+        printf("Size is empty!");
+        return {};
+    }
+
+    return performIndexJoinWithPrefilter(castKeys(castRelation), titleKeys(titleRelation), castChunkSize(options, COLUMN_KEY_BYTES_PER_TUPLE, castRelation.size(), numThreads), numThreads, options,
+                                         knownKeyOrder(castRelation, titleRelation));
+}
+
+// Writes the projected fields of the matched rows into their columns; rows maps the row ids of
+// the join result back to the relation
+template <typename Relation, typename Columns, typename Field>
+static void gatherProjectedColumns(const RelationVector<Relation>& relation, const vector<uint32_t>& rows, const JoinIndexVector& indexPairs,
+                                   uint32_t JoinIndexPair::*side, const FieldSet<Field>& projection, Columns& columns, int numThreads) {
+    forEachField<Relation>([&](size_t field, auto member, auto column) {
+        if (!projection.contains(field)) {
+            return;
+        }
+        auto& output = columns.*column;
+        output.resize(indexPairs.size());
+#pragma omp parallel for schedule(static) num_threads(numThreads) shared(relation, rows, indexPairs, side, output, member)
+        for (size_t i = 0; i < indexPairs.size(); ++i) {
+            const auto& value = relation[rows[indexPairs[i].*side]].*member;
+            if constexpr (std::is_array_v<std::remove_cvref_t<decltype(value)>>) {
+                std::memcpy(output[i].data(), value, sizeof(value));
+            } else {
+                output[i] = value;
+            }
+        }
+    });
+}
 
-        castSlices.emplace_back(castRelation.begin() + cast_offset, castRelation.begin() + cast_end);
-        titleSlices.emplace_back(titleRelation.begin() + title_offset, titleRelation.begin() + title_end);
+ProjectedJoinResult performProjectedJoin(const RelationVector<CastRelation>& castRelation, const RelationVector<TitleRelation>& titleRelation, const JoinQuery& query, int numThreads, const JoinOptions& options) {
+    ProjectedJoinResult result{query.castProjection, query.titleProjection};
+    if (!validPredicates<CastRelation>(query.castPredicates) || !validPredicates<TitleRelation>(query.titlePredicates)) {
+        return result;
+    }
 
-        title_offset += title_cutoff;
-        cast_offset += cast_cutoff;
+    const auto cast_predicates = bindPredicates<CastRelation>(query.castPredicates);
+    const auto title_predicates = bindPredicates<TitleRelation>(query.titlePredicates);
+    const auto [cast_rows, title_rows] = profilePhase("select", numThreads, options, [&] {
+        return std::make_pair(selectRows(castRelation.size(), [&](size_t i) { return matchesAll(cast_predicates, castRelation[i]); }, numThreads),
+                              selectRows(titleRelation.size(), [&](size_t i) { return matchesAll(title_predicates, titleRelation[i]); }, numThreads));
+    });
+    if (cast_rows.empty() || title_rows.empty()) {
+        return result;
     }
 
-    if (cast_offset < castRelation.size() && title_offset < titleRelation.size()) {
-        castSlices.emplace_back(castRelation.begin() + cast_offset, castRelation.end());
-        titleSlices.emplace_back(titleRelation.begin() + title_offset, titleRelation.end());
+    // The join only sees the keys of the selected rows; sorted relations stay sorted
+    const auto cast_keys = views::transform(cast_rows, [&](uint32_t row) -> int32_t { return castRelation[row].movieId; });
+    const auto title_keys = views::transform(title_rows, [&](uint32_t row) -> int32_t { return titleRelation[row].titleId; });
+    const JoinIndexVector indexPairs =
+        performIndexJoinWithPrefilter(cast_keys, title_keys, castChunkSize(options, rowKeyBytesPerTuple(), cast_rows.size(), numThreads), numThreads, options);
+
+    result.numRows = indexPairs.size();
+    profilePhase("materialize", numThreads, options, [&] {
+        gatherProjectedColumns(castRelation, cast_rows, indexPairs, &JoinIndexPair::castIndex, query.castProjection, result.cast, numThreads);
+        gatherProjectedColumns(titleRelation, title_rows, indexPairs, &JoinIndexPair::titleIndex, query.titleProjection, result.title, numThreads);
+    });
+    return result;
+}
+
+// Adds join matches to an aggregation table. The group column and the optional value column are
+// bound to their row members; exactly one of the two group members is set.
+struct JoinAggregator {
+    const RelationVector<CastRelation>& castRelation;
+    const RelationVector<TitleRelation>& titleRelation;
+    int32_t CastRelation::*castGroup = nullptr;
+    int32_t TitleRelation::*titleGroup = nullptr;
+    int32_t CastRelation::*castValue = nullptr;
+    int32_t TitleRelation::*titleValue = nullptr;
+
+    // The cast rows castRow(begin) ... castRow(end - 1) all match titleRow
+    template <typename CastRow>
+    void addRun(PartitionedAggregationTable& table, size_t begin, size_t end, CastRow&& castRow, size_t titleRow) const {
+        const TitleRelation& title = titleRelation[titleRow];
+        const int32_t title_value = titleValue != nullptr ? title.*titleValue : 0;
+        if (titleGroup != nullptr && castValue == nullptr) {
+            // Group and value are the same for the whole run
+            const auto matches = static_cast<uint64_t>(end - begin);
+            table.add({title.*titleGroup, matches, static_cast<int64_t>(title_value) * static_cast<int64_t>(matches), title_value, title_value});
+            return;
+        }
+        for (size_t i = begin; i < end; ++i) {
+            const CastRelation& cast = castRelation[castRow(i)];
+            const int32_t value = castValue != nullptr ? cast.*castValue : title_value;
+            table.add({titleGroup != nullptr ? title.*titleGroup : cast.*castGroup, 1, value, value, value});
+        }
     }
+};
 
-    if(castSlices.size() != titleSlices.size()) {
-        printf("Unterschiedlich viele Chunks!");
+// Aggregates the merge join of sorted keys; castRow and titleRow map key positions to row ids
+template <typename CastKeys, typename TitleKeys, typename CastRow, typename TitleRow>
+static void aggregateMergeJoin(const CastKeys& castKeys, const TitleKeys& titleKeys, CastRow&& castRow, TitleRow&& titleRow, const JoinAggregator& aggregator,
+                               vector<PartitionedAggregationTable>& tables, size_t index_of_cutoff, int numThreads, const JoinOptions& options) {
+    const vector<JoinPartition> partitions = profilePhase("partition", numThreads, options, [&] {
+        return partitionForJoin(castKeys, titleKeys, index_of_cutoff, numThreads, options);
+    });
+    profilePhase("join aggregate", numThreads, options, [&] {
+#pragma omp parallel num_threads(numThreads) shared(castKeys, titleKeys, castRow, titleRow, aggregator, tables, partitions)
+        {
+            PartitionedAggregationTable& table = tables[omp_get_thread_num()];
+#pragma omp for schedule(dynamic)
+            for (size_t i = 0; i < partitions.size(); ++i) {
+                mergeJoinThread(castKeys, titleKeys, partitions[i], [&](size_t cast_begin, size_t cast_end, size_t title_index) {
+                    aggregator.addRun(table, cast_begin, cast_end, castRow, titleRow(title_index));
+                });
+            }
+        }
+    });
+}
+
+vector<GroupAggregate> performJoinAggregation(const RelationVector<CastRelation>& castRelation, const RelationVector<TitleRelation>& titleRelation, const AggregationQuery& query,
+                                              int numThreads, const JoinOptions& options) {
+    JoinAggregator aggregator{castRelation, titleRelation};
+    bool valid = true;
+    const auto bind = [&](const JoinColumn& column, int32_t CastRelation::*& castMember, int32_t TitleRelation::*& titleMember) {
+        if (column.fromCast) {
+            castMember = integerMember<CastRelation>(column.field);
+        } else {
+            titleMember = integerMember<TitleRelation>(column.field);
+        }
+        if (castMember == nullptr && titleMember == nullptr) {
+            std::cerr << "Error: Aggregation over non-integer field " << column.field << std::endl;
+            valid = false;
+        }
+    };
+    bind(query.groupBy, aggregator.castGroup, aggregator.titleGroup);
+    if (query.value) {
+        bind(*query.value, aggregator.castValue, aggregator.titleValue);
+    }
+    if (!valid || castRelation.empty() || titleRelation.empty() || !fitsRowIds(castKeys(castRelation), titleKeys(titleRelation))) {
         return {};
     }
 
-    vector<vector<ResultRelation>> thread_results(castSlices.size());
+    const span<const CastRelation> cast_span(castRelation);
+    const span<const TitleRelation> title_span(titleRelation);
+    const size_t index_of_cutoff = castChunkSize(options, rowKeyBytesPerTuple(), castRelation.size(), numThreads);
+    const auto identity = [](size_t row) { return row; };
+    const auto parts = static_cast<size_t>(std::max(numThreads, 1));
+    vector<PartitionedAggregationTable> tables(parts, PartitionedAggregationTable(parts));
+
+    if (options.algorithm == JoinAlgorithm::RadixHash) {
+        profilePhase("join aggregate", numThreads, options, [&] {
+            radixHashJoinForEach(castKeys(cast_span), titleKeys(title_span), numThreads, [&](size_t, uint32_t cast_row, uint32_t title_row) {
+                aggregator.addRun(tables[omp_get_thread_num()], cast_row, cast_row + 1, identity, title_row);
+            });
+        });
+    } else if (auto table = options.algorithm == JoinAlgorithm::DirectAddress ? buildDirectAddressTable(titleKeys(title_span), numThreads) : std::nullopt) {
+        profilePhase("join aggregate", numThreads, options, [&] {
+#pragma omp parallel for schedule(static) num_threads(numThreads) shared(castRelation, table, aggregator, tables, identity)
+            for (size_t i = 0; i < castRelation.size(); ++i) {
+                const uint32_t* slot = table->slot(castRelation[i].movieId);
+                if (slot != nullptr && *slot != DIRECT_ADDRESS_EMPTY) {
+                    aggregator.addRun(tables[omp_get_thread_num()], i, i + 1, identity, *slot);
+                }
+            }
+        });
+    } else {
+        // Sort-merge join, also the fallback of the direct address join
+        const bool cast_sorted = isSortedParallel(castKeys(cast_span), numThreads);
+        const bool title_sorted = isSortedParallel(titleKeys(title_span), numThreads);
+        if (cast_sorted && title_sorted) {
+            aggregateMergeJoin(castKeys(cast_span), titleKeys(title_span), identity, identity, aggregator, tables, index_of_cutoff, numThreads, options);
+        } else {
+            const auto [sorted_cast, sorted_title] = profilePhase("sort", numThreads, options, [&] {
+                return std::make_pair(sortKeyRows(castKeys(cast_span), cast_sorted, numThreads), sortKeyRows(titleKeys(title_span), title_sorted, numThreads));
+            });
+            aggregateMergeJoin(views::transform(sorted_cast, &RadixTuple::key), views::transform(sorted_title, &RadixTuple::key),
+                               [&](size_t i) { return sorted_cast[i].row; }, [&](size_t i) { return sorted_title[i].row; }, aggregator, tables,
+                               index_of_cutoff, numThreads, options);
+        }
+    }
+
+    return profilePhase("merge", numThreads, options, [&] { return mergeAggregationTables(tables, numThreads); });
+}
+
+//==--------------------------------------------------------------------==//
+//==--------------------------- STREAMING JOIN -------------------------==//
+//==--------------------------------------------------------------------==//
+
+// Buffered tuples of one sorted input stream
+template <typename Relation>
+struct SortedStream {
+    const std::function<size_t(RelationVector<Relation>&, size_t)>& reader;
+    int32_t Relation::*key;
+    RelationVector<Relation> buffer = {};
+    size_t tuplesRead = 0;
+    bool exhausted = false;
+    bool sorted = true;
+    bool hasLastKey = false;
+    int32_t lastKey = 0;
+
+    // Appends the next batch behind the tuples that are still buffered and checks the key order
+    void readBatch(size_t batchSize) {
+        const size_t begin = buffer.size();
+        if (exhausted || reader(buffer, batchSize) == 0) {
+            exhausted = true;
+            return;
+        }
+        tuplesRead += buffer.size() - begin;
+        for (size_t i = begin; i < buffer.size(); ++i) {
+            sorted = sorted && (!hasLastKey || lastKey <= buffer[i].*key);
+            lastKey = buffer[i].*key;
+            hasLastKey = true;
+        }
+    }
+
+    // Number of leading tuples before the key run at the end of the buffer
+    [[nodiscard]] size_t closedPrefix() const {
+        return buffer.empty() ? 0 : splitCast(views::transform(buffer, key), buffer.size() - 1);
+    }
+
+    void dropPrefix(size_t count) {
+        buffer.erase(buffer.begin(), buffer.begin() + static_cast<ptrdiff_t>(count));
+    }
+};
+
+StreamingJoinStats performStreamingJoin(const CastBatchReader& castReader, const TitleBatchReader& titleReader, const ResultSink& sink, const StreamingJoinOptions& options) {
+    const size_t batch_size = std::max<size_t>(options.batchSize, 1);
+    const size_t result_batch_size = std::max<size_t>(options.resultBatchSize, 1);
+    SortedStream<CastRelation> cast{castReader, &CastRelation::movieId};
+    SortedStream<TitleRelation> title{titleReader, &TitleRelation::titleId};
+    StreamingJoinStats stats;
+
+    // Joins a closed cast segment with a slice of titles in memory and hands the result to the sink
+    const auto join_batch = [&](span<const CastRelation> cast_segment, span<const TitleRelation> titles) {
+        if (cast_segment.empty() || titles.empty()) {
+            return;
+        }
+        const ResultVector results = performMaterializedJoin(cast_segment, titles, castChunkSize({}, ROW_BYTES_PER_TUPLE, cast_segment.size(), options.numThreads), options.numThreads, {});
+        for (size_t begin = 0; begin < results.size(); begin += result_batch_size) {
+            sink(span<const ResultRelation>(results).subspan(begin, std::min(result_batch_size, results.size() - begin)));
+        }
+        stats.resultTuples += results.size();
+    };
+    const auto input_sorted = [&]() {
+        stats.castTuples = cast.tuplesRead;
+        stats.titleTuples = title.tuplesRead;
+        stats.peakBufferedTuples = std::max(stats.peakBufferedTuples, cast.buffer.size() + title.buffer.size());
+        if (!cast.sorted || !title.sorted) {
+            std::cerr << "Error: Streaming join input is not sorted by the join key" << std::endl;
+            stats.sortedInput = false;
+        }
+        return stats.sortedInput;
+    };
+
+    title.readBatch(batch_size);
+    while (true) {
+        cast.readBatch(batch_size);
+        if (cast.buffer.empty() || !input_sorted()) {
+            break;
+        }
+        // The last key run of the batch may continue in the next one, so it is carried over
+        // until the stream ends
+        const size_t closed_end = cast.exhausted ? cast.buffer.size() : cast.closedPrefix();
+        if (closed_end == 0) {
+            continue;
+        }
+        const span<const CastRelation> cast_segment(cast.buffer.data(), closed_end);
+        const int32_t max_key = cast_segment.back().movieId;
+
+        // Titles below the last key of a title batch are done once they met this segment,
+        // because every later cast key is larger than max_key
+        while (!title.exhausted && (title.buffer.empty() || title.buffer.back().titleId <= max_key)) {
+            const size_t title_closed = title.closedPrefix();
+            join_batch(cast_segment, span<const TitleRelation>(title.buffer.data(), title_closed));
+            title.dropPrefix(title_closed);
+            title.readBatch(batch_size);
+            if (!input_sorted()) {
+                return stats;
+            }
+        }
+        join_batch(cast_segment, title.buffer);
+
+        title.dropPrefix(std::ranges::upper_bound(title.buffer, max_key, {}, &TitleRelation::titleId) - title.buffer.begin());
+        cast.dropPrefix(closed_end);
+    }
+
+    return stats;
+}
+
+
+//==--------------------------------------------------------------------==//
+//==----------------------------- TESTS --------------------------------==//
+//==--------------------------------------------------------------------==//
+
+// Builds sorted relations in which every third title has no cast and every
+// cast tuple with movieId >= numTitles has no title.
+static pair<RelationVector<CastRelation>, RelationVector<TitleRelation>> createSortedRelations(int numTitles, int maxCastPerTitle) {
+    RelationVector<TitleRelation> titles;
+    RelationVector<CastRelation> casts;
+    int castInfoId = 0;
+    for (int id = 0; id < numTitles + 10; ++id) {
+        if (id < numTitles) {
+            TitleRelation title{};
+            title.titleId = id;
+            snprintf(title.title, sizeof(title.title), "Title %d", id);
+            title.productionYear = 1900 + id % 120;
+            titles.push_back(title);
+        }
+        if (id % 3 == 0) {
+            continue;
+        }
+        for (int c = 0; c < 1 + (id * 7) % maxCastPerTitle; ++c) {
+            CastRelation cast{};
+            cast.castInfoId = castInfoId++;
+            cast.personId = id * 31 + c;
+            cast.movieId = id;
+            snprintf(cast.note, sizeof(cast.note), "Note %d", c);
+            cast.roleId = c % 11;
+            casts.push_back(cast);
+        }
+    }
+    return {casts, titles};
+}
+
+// Same relations in a fixed pseudo random order
+static pair<RelationVector<CastRelation>, RelationVector<TitleRelation>> createUnsortedRelations(int numTitles, int maxCastPerTitle) {
+    auto [castRelation, titleRelation] = createSortedRelations(numTitles, maxCastPerTitle);
+    std::mt19937 generator(7);
+    std::shuffle(castRelation.begin(), castRelation.end(), generator);
+    std::shuffle(titleRelation.begin(), titleRelation.end(), generator);
+    return {castRelation, titleRelation};
+}
+
+static ResultVector performReferenceJoin(const RelationVector<CastRelation>& castRelation, const RelationVector<TitleRelation>& titleRelation) {
+    ResultVector result;
+    for (const auto& cast : castRelation) {
+        for (const auto& title : titleRelation) {
+            if (cast.movieId == title.titleId) {
+                result.push_back(createResultTuple(cast, title));
+            }
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+static void expectPartitionsCoverRelations(const vector<JoinPartition>& partitions, const RelationVector<CastRelation>& castRelation, const RelationVector<TitleRelation>& titleRelation) {
+    ASSERT_FALSE(partitions.empty());
+    EXPECT_EQ(partitions.front().castBegin, 0u);
+    EXPECT_EQ(partitions.front().titleBegin, 0u);
+    EXPECT_EQ(partitions.back().castEnd, castRelation.size());
+    EXPECT_EQ(partitions.back().titleEnd, titleRelation.size());
+    for (size_t i = 1; i < partitions.size(); ++i) {
+        EXPECT_EQ(partitions[i].castBegin, partitions[i - 1].castEnd);
+        EXPECT_EQ(partitions[i].titleBegin, partitions[i - 1].titleEnd);
+        EXPECT_NE(castRelation[partitions[i].castBegin].movieId, castRelation[partitions[i].castBegin - 1].movieId);
+    }
+}
+
+TEST(JoinTest, TestPartitionsCoverRelations) {
+    const auto [castRelation, titleRelation] = createSortedRelations(5000, 40);
+
+    expectPartitionsCoverRelations(partitionRelations(castRelation, titleRelation, 500), castRelation, titleRelation);
+    expectPartitionsCoverRelations(partitionRelationsBySplitters(castRelation, titleRelation, 500, 4), castRelation, titleRelation);
+}
+
+TEST(JoinTest, TestJoinMatchesReference) {
+    const auto [castRelation, titleRelation] = createSortedRelations(3000, 25);
+
+    const auto expected = performReferenceJoin(castRelation, titleRelation);
+
+    for (auto strategy : {PartitionStrategy::SequentialScan, PartitionStrategy::KeySplitters}) {
+        auto result = performJoin(castRelation, titleRelation, 4, {.partitionStrategy = strategy});
+        std::sort(result.begin(), result.end());
+        EXPECT_EQ(result, expected);
+    }
+}
+
+TEST(JoinTest, TestLateMaterializedJoinMatchesReference) {
+    const auto [castRelation, titleRelation] = createSortedRelations(3000, 25);
 
-    for (int i = 0; i < thread_results.size(); i++) {
-        thread_results[i].reserve(floor(castSlices[i].size() * 1.25));
+    const JoinResultView view = performLateMaterializedJoin(castRelation, titleRelation, 4);
+    for (size_t i = 0; i < view.size(); ++i) {
+        ASSERT_EQ(view.castColumn(i, &CastRelation::movieId), view.titleColumn(i, &TitleRelation::titleId));
     }
 
-#pragma omp parallel for schedule(dynamic) num_threads(numThreads) default(none) shared(castSlices, titleSlices, thread_results)
-    for (int i = 0; i < static_cast<int>(castSlices.size()); ++i) {
-        thread_results[i] = performJoinThread(castSlices[i], titleSlices[i]);
+    auto result = view.materialize();
+    std::sort(result.begin(), result.end());
+    EXPECT_EQ(result, performReferenceJoin(castRelation, titleRelation));
+}
+
+TEST(JoinTest, TestColumnarJoinMatchesReference) {
+    const auto [castRelation, titleRelation] = createSortedRelations(3000, 25);
+    const CastColumns castColumns = toColumns(castRelation);
+    const TitleColumns titleColumns = toColumns(titleRelation);
+    const auto expected = performReferenceJoin(castRelation, titleRelation);
+
+    auto result = performJoin(castColumns, titleColumns, 4);
+    std::sort(result.begin(), result.end());
+    EXPECT_EQ(result, expected);
+
+    ResultVector fromIndices;
+    for (const auto& [castIndex, titleIndex] : performJoinIndices(castColumns, titleColumns, 4)) {
+        fromIndices.push_back(createResultTuple(castColumns, castIndex, titleColumns, titleIndex));
     }
+    std::sort(fromIndices.begin(), fromIndices.end());
+    EXPECT_EQ(fromIndices, expected);
+}
 
-    size_t totalSize = 0;
-    for (const auto& localResultRelation : thread_results) {
-        totalSize += localResultRelation.size();
+TEST(JoinTest, TestSimdMergeKernelsMatchScalar) {
+    // Sorted keys with duplicates on both sides and gaps of varying length
+    std::mt19937 generator(42);
+    vector<int32_t> castKeys(20000);
+    vector<int32_t> titleKeys(5000);
+    int32_t key = 0;
+    for (auto& castKey : castKeys) {
+        key += generator() % 4 == 0 ? static_cast<int32_t>(generator() % 40) : 0;
+        castKey = key;
+    }
+    key = 0;
+    for (auto& titleKey : titleKeys) {
+        key += static_cast<int32_t>(generator() % 3 == 0 ? 0 : generator() % 60);
+        titleKey = key;
     }
 
-    resultRelation.reserve(totalSize);
+    auto collectRuns = [&](SimdLevel level) {
+        vector<array<size_t, 3>> runs;
+        mergeJoinKeys(level, castKeys.data(), 3, castKeys.size() - 5, titleKeys.data(), 1, titleKeys.size(), [&](size_t cast_begin, size_t cast_end, size_t title_index) {
+            runs.push_back({cast_begin, cast_end, title_index});
+        });
+        return runs;
+    };
 
-    for (const auto& vec : thread_results) {
-        resultRelation.insert(resultRelation.end(), vec.begin(), vec.end());
+    const auto expected = collectRuns(SimdLevel::Scalar);
+    ASSERT_FALSE(expected.empty());
+    if (detectSimdLevel() == SimdLevel::Scalar) {
+        GTEST_SKIP() << "CPU supports neither AVX2 nor AVX-512";
     }
+    EXPECT_EQ(collectRuns(SimdLevel::Avx2), expected);
+    if (detectSimdLevel() == SimdLevel::Avx512) {
+        EXPECT_EQ(collectRuns(SimdLevel::Avx512), expected);
+    }
+}
 
-    return resultRelation;
+TEST(JoinTest, TestRadixHashJoinOnUnsortedInput) {
+    const auto [castRelation, titleRelation] = createUnsortedRelations(3000, 25);
+    const auto expected = performReferenceJoin(castRelation, titleRelation);
+
+    for (int numThreads : {1, 4}) {
+        auto result = performJoin(castRelation, titleRelation, numThreads, {.algorithm = JoinAlgorithm::RadixHash});
+        std::sort(result.begin(), result.end());
+        EXPECT_EQ(result, expected);
+
+        auto columnarResult = performJoin(toColumns(castRelation), toColumns(titleRelation), numThreads, {.algorithm = JoinAlgorithm::RadixHash});
+        std::sort(columnarResult.begin(), columnarResult.end());
+        EXPECT_EQ(columnarResult, expected);
+    }
+}
+
+TEST(JoinTest, TestDirectAddressJoinMatchesReference) {
+    const auto [castRelation, titleRelation] = createUnsortedRelations(3000, 25);
+    const auto expected = performReferenceJoin(castRelation, titleRelation);
+
+    for (int numThreads : {1, 4}) {
+        auto result = performJoin(castRelation, titleRelation, numThreads, {.algorithm = JoinAlgorithm::DirectAddress});
+        std::sort(result.begin(), result.end());
+        EXPECT_EQ(result, expected);
+
+        auto columnarResult = performJoin(toColumns(castRelation), toColumns(titleRelation), numThreads, {.algorithm = JoinAlgorithm::DirectAddress});
+        std::sort(columnarResult.begin(), columnarResult.end());
+        EXPECT_EQ(columnarResult, expected);
+
+        // The probe scans the cast relation in order
+        const auto view = performLateMaterializedJoin(castRelation, titleRelation, numThreads, {.algorithm = JoinAlgorithm::DirectAddress});
+        EXPECT_TRUE(std::ranges::is_sorted(view.getIndexPairs(), {}, &JoinIndexPair::castIndex));
+    }
+}
+
+TEST(JoinTest, TestDirectAddressJoinFallsBackForSparseOrDuplicateKeys) {
+    vector<int32_t> titleIds(1000);
+    std::iota(titleIds.begin(), titleIds.end(), -500);
+    const auto table = buildDirectAddressTable(titleIds, 4);
+    ASSERT_TRUE(table.has_value());
+    EXPECT_EQ(table->rows.size(), titleIds.size());
+    EXPECT_EQ(*table->slot(-500), 0u);
+    EXPECT_EQ(table->slot(-501), nullptr);
+    EXPECT_EQ(table->slot(500), nullptr);
+
+    titleIds[999] = 3499;
+    EXPECT_TRUE(buildDirectAddressTable(titleIds, 4).has_value());
+    titleIds[999] = 5000;
+    EXPECT_FALSE(buildDirectAddressTable(titleIds, 4).has_value());
+    titleIds[999] = 7;
+    EXPECT_FALSE(buildDirectAddressTable(titleIds, 4).has_value());
+
+    // Sparse and duplicate titleIds still join through the sort-merge fallback
+    auto [castRelation, titleRelation] = createSortedRelations(3000, 25);
+    for (auto& title : titleRelation) {
+        title.titleId *= 10;
+    }
+    for (auto& cast : castRelation) {
+        cast.movieId *= 10;
+    }
+    titleRelation.push_back(titleRelation[100]);
+    std::sort(titleRelation.begin(), titleRelation.end(), [](const auto& a, const auto& b) { return a.titleId < b.titleId; });
+    auto result = performJoin(castRelation, titleRelation, 4, {.algorithm = JoinAlgorithm::DirectAddress});
+    std::sort(result.begin(), result.end());
+    EXPECT_EQ(result, performReferenceJoin(castRelation, titleRelation));
+}
+
+TEST(JoinTest, TestSemiJoinPrefilterDropsNonMatchingTuples) {
+    auto [castRelation, titleRelation] = createUnsortedRelations(3000, 25);
+    // A filtered title set: most cast tuples lose their join partner
+    std::erase_if(titleRelation, [](const TitleRelation& title) { return title.titleId % 5 != 0; });
+    const auto expected = performReferenceJoin(castRelation, titleRelation);
+
+    for (auto prefilter : {SemiJoinPrefilter::Bloom, SemiJoinPrefilter::Bitmap, SemiJoinPrefilter::Auto}) {
+        for (auto algorithm : {JoinAlgorithm::SortMerge, JoinAlgorithm::RadixHash, JoinAlgorithm::DirectAddress}) {
+            PrefilterStats stats;
+            auto result = performJoin(castRelation, titleRelation, 4, {.algorithm = algorithm, .prefilter = prefilter, .prefilterStats = &stats});
+            std::sort(result.begin(), result.end());
+            EXPECT_EQ(result, expected);
+
+            EXPECT_TRUE(stats.castFiltered);
+            EXPECT_EQ(stats.inputTuples, castRelation.size());
+            EXPECT_GE(stats.passedTuples, stats.matchingTuples);
+            EXPECT_GT(stats.droppedTuples(), castRelation.size() / 2);
+            // The title keys are dense, so only an explicit Bloom request builds a Bloom filter
+            EXPECT_EQ(stats.filter, prefilter == SemiJoinPrefilter::Bloom ? SemiJoinPrefilter::Bloom : SemiJoinPrefilter::Bitmap);
+            if (stats.filter == SemiJoinPrefilter::Bitmap) {
+                EXPECT_EQ(stats.passedTuples, stats.matchingTuples);
+            } else {
+                EXPECT_LT(stats.falsePositiveRate(), 0.05);
+            }
+        }
+    }
+
+    auto columnarResult = performJoin(toColumns(castRelation), toColumns(titleRelation), 4, {.prefilter = SemiJoinPrefilter::Bloom});
+    std::sort(columnarResult.begin(), columnarResult.end());
+    EXPECT_EQ(columnarResult, expected);
+
+    // With the cast side smaller, the title relation is filtered instead
+    const RelationVector<CastRelation> fewCasts(castRelation.begin(), castRelation.begin() + 200);
+    PrefilterStats stats;
+    auto fewResult = performLateMaterializedJoin(fewCasts, titleRelation, 4, {.prefilter = SemiJoinPrefilter::Auto, .prefilterStats = &stats}).materialize();
+    std::sort(fewResult.begin(), fewResult.end());
+    EXPECT_EQ(fewResult, performReferenceJoin(fewCasts, titleRelation));
+    EXPECT_FALSE(stats.castFiltered);
+    EXPECT_EQ(stats.inputTuples, titleRelation.size());
+}
+
+TEST(JoinTest, TestRadixPartitionWithTwoPasses) {
+    vector<int32_t> keys(100000);
+    std::iota(keys.begin(), keys.end(), -5000);
+    vector<size_t> bounds;
+    const unsigned bits = RADIX_MAX_BITS_PER_PASS + 3;
+    const auto partitioned = radixPartition(keys, bits, 4, bounds);
+
+    ASSERT_EQ(bounds.size(), (size_t{1} << bits) + 1);
+    EXPECT_EQ(bounds.back(), keys.size());
+    for (size_t partition = 0; partition + 1 < bounds.size(); ++partition) {
+        for (size_t i = bounds[partition]; i < bounds[partition + 1]; ++i) {
+            // First pass bits select the outer partition, second pass bits the sub-partition
+            const uint32_t hash = radixHash(partitioned[i].key);
+            ASSERT_EQ(((hash & ((1u << RADIX_MAX_BITS_PER_PASS) - 1)) << 3) | ((hash >> RADIX_MAX_BITS_PER_PASS) & 0x7u), partition);
+            ASSERT_EQ(keys[partitioned[i].row], partitioned[i].key);
+        }
+    }
+}
+
+TEST(JoinTest, TestSortMergeJoinOnUnsortedInput) {
+    const auto [castRelation, titleRelation] = createUnsortedRelations(3000, 25);
+    const auto expected = performReferenceJoin(castRelation, titleRelation);
+
+    auto result = performJoin(castRelation, titleRelation, 4);
+    std::sort(result.begin(), result.end());
+    EXPECT_EQ(result, expected);
+
+    // Only one side unsorted
+    const auto [sortedCast, sortedTitle] = createSortedRelations(3000, 25);
+    auto mixedResult = performLateMaterializedJoin(sortedCast, titleRelation, 4).materialize();
+    std::sort(mixedResult.begin(), mixedResult.end());
+    EXPECT_EQ(mixedResult, expected);
+}
+
+TEST(JoinTest, TestParallelRadixSort) {
+    std::mt19937 generator(3);
+    vector<int32_t> keys(50000);
+    for (auto& key : keys) {
+        key = static_cast<int32_t>(generator() % 2000) - 1000;
+    }
+    EXPECT_FALSE(isSortedParallel(keys, 4));
+
+    const auto sorted = parallelRadixSort(keys, 4);
+    ASSERT_EQ(sorted.size(), keys.size());
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        ASSERT_EQ(keys[sorted[i].row], sorted[i].key);
+        if (i > 0) {
+            // Stable: equal keys keep their input order
+            ASSERT_TRUE(sorted[i - 1].key < sorted[i].key || (sorted[i - 1].key == sorted[i].key && sorted[i - 1].row < sorted[i].row));
+        }
+    }
+    EXPECT_TRUE(isSortedParallel(views::transform(sorted, &RadixTuple::key), 4));
+}
+
+TEST(JoinTest, TestLoadCsvFromMappedFile) {
+    const auto path = std::filesystem::temp_directory_path() / "ppds_cast_loader_test.csv";
+    {
+        std::ofstream file(path);
+        file << "id,person_id,movie_id,person_role_id,note,nr_order,role_id\n";
+        file << "1,10,100,1000,(voice),1,2\n";
+        file << "2,20,100,2000,,2,3\r\n";
+        file << "not,a,valid,line\n";
+        file << "4,40,102,,,4,5\n";
+        file << "3,30,101,3000,a note that is fine,3,4";
+    }
+
+    const auto relation = loadCastRelation(path.string());
+    ASSERT_EQ(relation.size(), 3u);
+    EXPECT_EQ(castRelationToString(relation[0]), "1,10,100,1000,(voice),1,2");
+    EXPECT_EQ(castRelationToString(relation[1]), "2,20,100,2000,,2,3");
+    EXPECT_EQ(castRelationToString(relation[2]), "3,30,101,3000,a note that is fine,3,4");
+
+    const auto limited = loadCastColumns(path.string(), 1);
+    ASSERT_EQ(limited.size(), 1u);
+    EXPECT_EQ(limited.movieId[0], 100);
+
+    std::filesystem::remove(path);
+}
+
+TEST(JoinTest, TestScanPushesPredicatesAndProjectionIntoLoad) {
+    const auto path = std::filesystem::temp_directory_path() / "ppds_title_scan_test.csv";
+    const auto [castRelation, titleRelation] = createSortedRelations(3000, 5);
+    {
+        std::ofstream file(path);
+        file << "id,title,imdb_index,kind_id,production_year,imdb_id,phonetic_code,episode_of_id,season_nr,episode_nr,series_years,md5sum\n";
+        for (const auto& title : titleRelation) {
+            file << titleRelationToString(title) << '\n';
+        }
+    }
+
+    ScanSpec<TitleRelation> spec;
+    spec.predicates = {{TitleField::ProductionYear, Compare::Greater, 2000}, {TitleField::TitleId, Compare::Less, 2500}};
+    spec.projection = {TitleField::TitleId, TitleField::Title};
+    const auto scanned = scanTitleRelation(path.string(), spec, SIZE_MAX, 4);
+
+    RelationVector<TitleRelation> expected;
+    std::ranges::copy_if(titleRelation, std::back_inserter(expected), [](const TitleRelation& title) {
+        return title.productionYear > 2000 && title.titleId < 2500;
+    });
+    ASSERT_EQ(scanned.size(), expected.size());
+    for (size_t i = 0; i < scanned.size(); ++i) {
+        EXPECT_EQ(scanned[i].titleId, expected[i].titleId);
+        EXPECT_STREQ(scanned[i].title, expected[i].title);
+        // Fields outside of the projection are not parsed
+        EXPECT_EQ(scanned[i].productionYear, 0);
+    }
+
+    // The limit counts tuples that pass the predicates
+    const auto limited = scanTitleRelation(path.string(), spec, 10, 4);
+    ASSERT_EQ(limited.size(), 10u);
+    EXPECT_EQ(limited.back().titleId, expected[9].titleId);
+
+    spec.predicates = {{TitleField::Title, Compare::Equal, 0}};
+    EXPECT_TRUE(scanTitleRelation(path.string(), spec).empty());
+    std::filesystem::remove(path);
+}
+
+TEST(JoinTest, TestProjectedJoinMatchesFilteredReference) {
+    const auto [castRelation, titleRelation] = createSortedRelations(3000, 25);
+    JoinQuery query;
+    query.titlePredicates = {{TitleField::ProductionYear, Compare::Greater, 2000}};
+    query.castPredicates = {{CastField::RoleId, Compare::LessEqual, 4}};
+    query.castProjection = {CastField::PersonId, CastField::RoleId};
+    query.titleProjection = {TitleField::Title};
+
+    vector<tuple<string, int32_t, int32_t>> expected;
+    for (const auto& tuple : performReferenceJoin(castRelation, titleRelation)) {
+        if (tuple.productionYear > 2000 && tuple.roleId <= 4) {
+            expected.emplace_back(tuple.title, tuple.personId, tuple.roleId);
+        }
+    }
+    std::sort(expected.begin(), expected.end());
+    ASSERT_FALSE(expected.empty());
+
+    for (auto algorithm : {JoinAlgorithm::SortMerge, JoinAlgorithm::RadixHash, JoinAlgorithm::DirectAddress}) {
+        const ProjectedJoinResult result = performProjectedJoin(castRelation, titleRelation, query, 4, {.algorithm = algorithm});
+        ASSERT_EQ(result.size(), expected.size());
+        vector<tuple<string, int32_t, int32_t>> actual;
+        for (size_t i = 0; i < result.size(); ++i) {
+            actual.emplace_back(result.title.title[i].data(), result.cast.personId[i], result.cast.roleId[i]);
+        }
+        std::sort(actual.begin(), actual.end());
+        EXPECT_EQ(actual, expected);
+
+        // Only the projected columns are written
+        EXPECT_TRUE(result.cast.note.empty());
+        EXPECT_TRUE(result.title.titleId.empty());
+        EXPECT_EQ(result.bytes(), result.size() * (2 * sizeof(int32_t) + sizeof(TitleRelation::title)));
+    }
+
+    query.castPredicates = {{CastField::Note, Compare::Equal, 1}};
+    EXPECT_TRUE(performProjectedJoin(castRelation, titleRelation, query, 4).empty());
+}
+
+// Aggregates the materialized reference join with a std::map
+static vector<GroupAggregate> aggregateReferenceJoin(const RelationVector<CastRelation>& castRelation, const RelationVector<TitleRelation>& titleRelation,
+                                                     int32_t ResultRelation::*groupBy, int32_t ResultRelation::*value) {
+    std::map<int32_t, GroupAggregate> groups;
+    for (const auto& tuple : performReferenceJoin(castRelation, titleRelation)) {
+        const int32_t key = tuple.*groupBy;
+        const int32_t v = value != nullptr ? tuple.*value : 0;
+        groups.try_emplace(key, GroupAggregate{key}).first->second.add({key, 1, v, v, v});
+    }
+    vector<GroupAggregate> result;
+    for (const auto& [key, group] : groups) {
+        result.push_back(group);
+    }
+    return result;
+}
+
+TEST(JoinTest, TestFusedJoinAggregationMatchesReference) {
+    const auto [sortedCast, sortedTitle] = createSortedRelations(3000, 25);
+    const auto [unsortedCast, unsortedTitle] = createUnsortedRelations(3000, 25);
+
+    // Roles per production year, cast members per movie and production years per cast role
+    const vector<pair<AggregationQuery, vector<GroupAggregate>>> queries = {
+        {{JoinColumn::title(TitleField::ProductionYear), JoinColumn::cast(CastField::RoleId)},
+         aggregateReferenceJoin(sortedCast, sortedTitle, &ResultRelation::productionYear, &ResultRelation::roleId)},
+        {{JoinColumn::title(TitleField::TitleId), std::nullopt}, aggregateReferenceJoin(sortedCast, sortedTitle, &ResultRelation::titleId, nullptr)},
+        {{JoinColumn::cast(CastField::RoleId), JoinColumn::title(TitleField::ProductionYear)},
+         aggregateReferenceJoin(sortedCast, sortedTitle, &ResultRelation::roleId, &ResultRelation::productionYear)},
+    };
+
+    for (const auto& [query, expected] : queries) {
+        for (auto algorithm : {JoinAlgorithm::SortMerge, JoinAlgorithm::RadixHash, JoinAlgorithm::DirectAddress}) {
+            for (int numThreads : {1, 3, 4}) {
+                EXPECT_EQ(performJoinAggregation(sortedCast, sortedTitle, query, numThreads, {.algorithm = algorithm}), expected);
+                EXPECT_EQ(performJoinAggregation(unsortedCast, unsortedTitle, query, numThreads, {.algorithm = algorithm}), expected);
+            }
+        }
+    }
+
+    EXPECT_TRUE(performJoinAggregation(sortedCast, sortedTitle, {JoinColumn::cast(CastField::Note), std::nullopt}, 4).empty());
+}
+
+TEST(JoinTest, TestParallelLoadKeepsFileOrder) {
+    const auto path = std::filesystem::temp_directory_path() / "ppds_title_loader_test.csv";
+    const auto [castRelation, titleRelation] = createSortedRelations(20000, 2);
+    {
+        std::ofstream file(path);
+        file << "id,title,imdb_index,kind_id,production_year,imdb_id,phonetic_code,episode_of_id,season_nr,episode_nr,series_years,md5sum\n";
+        for (size_t i = 0; i < titleRelation.size(); ++i) {
+            file << titleRelationToString(titleRelation[i]) << '\n';
+            if (i == 10 || i == 15000) {
+                file << "broken line\n";
+            }
+        }
+    }
+
+    const auto serial = loadTitleRelation(path.string(), SIZE_MAX, 1);
+    const auto parallel = loadTitleRelation(path.string(), SIZE_MAX, 4);
+    ASSERT_EQ(parallel.size(), titleRelation.size());
+    ASSERT_EQ(serial.size(), parallel.size());
+    for (size_t i = 0; i < parallel.size(); ++i) {
+        ASSERT_EQ(titleRelationToString(parallel[i]), titleRelationToString(titleRelation[i]));
+        ASSERT_EQ(titleRelationToString(serial[i]), titleRelationToString(titleRelation[i]));
+    }
+
+    // The broken line inside the limit does not count towards it
+    const auto limited = loadTitleColumns(path.string(), 100, 4);
+    ASSERT_EQ(limited.size(), 100u);
+    EXPECT_EQ(limited.titleId.back(), titleRelation[99].titleId);
+
+    std::filesystem::remove(path);
+}
+
+TEST(JoinTest, TestColumnarSnapshotRoundTrip) {
+    const auto directory = std::filesystem::temp_directory_path();
+    const auto [castRelation, titleRelation] = createSortedRelations(2000, 5);
+    const CastColumns castColumns = toColumns(castRelation);
+
+    const std::string snapshot = (directory / "ppds_cast_snapshot_test.colsnap").string();
+    ASSERT_TRUE(writeSnapshot(snapshot, castColumns));
+    CastColumns reloaded;
+    SnapshotHeader header{};
+    ASSERT_TRUE(readSnapshot(snapshot, reloaded, SIZE_MAX, nullptr, &header));
+    EXPECT_TRUE(header.sortedByKey);
+    ASSERT_EQ(reloaded.size(), castColumns.size());
+    for (size_t i = 0; i < reloaded.size(); ++i) {
+        ASSERT_EQ(castRelationToString(reloaded[i]), castRelationToString(castColumns[i]));
+    }
+    // The columns are views over the mapping and pass the key order on to the join
+    EXPECT_TRUE(reloaded.movieId.isMapped());
+    EXPECT_TRUE(reloaded.sortedByKey);
+    EXPECT_EQ(performJoin(reloaded, toColumns(titleRelation), 4), performJoin(castRelation, titleRelation, 4));
+    // Writes stay in the private mapping, growing a view copies it
+    reloaded.personId[0] += 1;
+    CastColumns again;
+    ASSERT_TRUE(readSnapshot(snapshot, again));
+    EXPECT_EQ(again.personId[0], castColumns.personId[0]);
+    reloaded.emplace_back(castRelation.front());
+    EXPECT_FALSE(reloaded.movieId.isMapped());
+    EXPECT_FALSE(reloaded.sortedByKey);
+    EXPECT_EQ(reloaded.personId[0], castColumns.personId[0] + 1);
+    // A cast snapshot is not a title relation
+    TitleColumns wrongSchema;
+    EXPECT_FALSE(readSnapshot(snapshot, wrongSchema));
+    std::filesystem::remove(snapshot);
+
+    // The first load parses the CSV and writes the snapshot, the second one only maps it
+    const auto csv = directory / "ppds_title_snapshot_test.csv";
+    {
+        std::ofstream file(csv);
+        file << "id,title,imdb_index,kind_id,production_year,imdb_id,phonetic_code,episode_of_id,season_nr,episode_nr,series_years,md5sum\n";
+        for (const auto& title : titleRelation) {
+            file << titleRelationToString(title) << '\n';
+        }
+    }
+    std::filesystem::remove(snapshotFilename(csv.string()));
+    const TitleColumns parsed = loadTitleColumnsWithSnapshot(csv.string(), 10);
+    ASSERT_TRUE(std::filesystem::exists(snapshotFilename(csv.string())));
+    const TitleColumns mapped = loadTitleColumnsWithSnapshot(csv.string(), 5);
+    ASSERT_EQ(parsed.size(), 10u);
+    ASSERT_EQ(mapped.size(), 5u);
+    for (size_t i = 0; i < mapped.size(); ++i) {
+        ASSERT_EQ(titleRelationToString(mapped[i]), titleRelationToString(titleRelation[i]));
+    }
+    // The snapshot only holds 10 rows, so asking for everything goes back to the CSV
+    const TitleColumns all = loadTitleColumnsWithSnapshot(csv.string());
+    ASSERT_EQ(all.size(), titleRelation.size());
+    EXPECT_EQ(titleRelationToString(all[all.size() - 1]), titleRelationToString(titleRelation.back()));
+
+    // A changed CSV file makes the snapshot stale
+    {
+        std::ofstream file(csv, std::ios::app);
+        file << titleRelationToString(titleRelation.front()) << '\n';
+    }
+    EXPECT_EQ(loadTitleColumnsWithSnapshot(csv.string()).size(), titleRelation.size() + 1);
+
+    std::filesystem::remove(snapshotFilename(csv.string()));
+    std::filesystem::remove(csv);
+}
+
+// Serves an in-memory relation to the streaming join batch by batch
+template <typename Relation>
+static std::function<size_t(RelationVector<Relation>&, size_t)> createBatchReader(const RelationVector<Relation>& relation) {
+    return [&relation, position = size_t{0}](RelationVector<Relation>& batch, size_t maxTuples) mutable {
+        const size_t count = std::min(maxTuples, relation.size() - position);
+        batch.insert(batch.end(), relation.begin() + position, relation.begin() + position + count);
+        position += count;
+        return count;
+    };
+}
+
+TEST(JoinTest, TestStreamingJoinMatchesReference) {
+    // Key runs of up to 25 cast tuples cross the batch boundaries
+    const auto [castRelation, titleRelation] = createSortedRelations(3000, 25);
+    const auto expected = performReferenceJoin(castRelation, titleRelation);
+
+    for (size_t batchSize : {1, 7, 64, 100000}) {
+        ResultVector result;
+        const StreamingJoinStats stats = performStreamingJoin(
+            createBatchReader(castRelation), createBatchReader(titleRelation),
+            [&](span<const ResultRelation> results) {
+                ASSERT_LE(results.size(), 50u);
+                result.insert(result.end(), results.begin(), results.end());
+            },
+            {.batchSize = batchSize, .resultBatchSize = 50, .numThreads = 4});
+
+        EXPECT_TRUE(stats.sortedInput);
+        EXPECT_EQ(stats.castTuples, castRelation.size());
+        EXPECT_EQ(stats.titleTuples, titleRelation.size());
+        EXPECT_EQ(stats.resultTuples, expected.size());
+        if (batchSize < 100) {
+            // Two batches plus the carried key runs
+            EXPECT_LE(stats.peakBufferedTuples, 2 * batchSize + 2 * 25);
+        }
+        std::sort(result.begin(), result.end());
+        EXPECT_EQ(result, expected);
+    }
+
+    const auto [unsortedCast, unsortedTitle] = createUnsortedRelations(100, 5);
+    const StreamingJoinStats stats = performStreamingJoin(createBatchReader(unsortedCast), createBatchReader(titleRelation), [](span<const ResultRelation>) {}, {.batchSize = 16});
+    EXPECT_FALSE(stats.sortedInput);
+}
+
+TEST(JoinTest, TestStreamingJoinFromCsvReaders) {
+    const auto directory = std::filesystem::temp_directory_path();
+    const auto castPath = directory / "ppds_cast_stream_test.csv";
+    const auto titlePath = directory / "ppds_title_stream_test.csv";
+    const auto [castRelation, titleRelation] = createSortedRelations(500, 10);
+    {
+        std::ofstream castFile(castPath);
+        castFile << "id,person_id,movie_id,person_role_id,note,nr_order,role_id\n";
+        for (const auto& cast : castRelation) {
+            castFile << castRelationToString(cast) << '\n';
+        }
+        std::ofstream titleFile(titlePath);
+        titleFile << "id,title,imdb_index,kind_id,production_year,imdb_id,phonetic_code,episode_of_id,season_nr,episode_nr,series_years,md5sum\n";
+        for (const auto& title : titleRelation) {
+            titleFile << titleRelationToString(title) << '\n';
+        }
+    }
+
+    // Buffers smaller than a line force refills and buffer growth
+    CsvBatchReader<CastRelation> castReader(castPath.string(), 16);
+    CsvBatchReader<TitleRelation> titleReader(titlePath.string(), 256);
+    ResultVector result;
+    performStreamingJoin(std::ref(castReader), std::ref(titleReader), [&](span<const ResultRelation> results) {
+        result.insert(result.end(), results.begin(), results.end());
+    }, {.batchSize = 33, .numThreads = 2});
+
+    std::sort(result.begin(), result.end());
+    EXPECT_EQ(result, performReferenceJoin(castRelation, titleRelation));
+
+    std::filesystem::remove(castPath);
+    std::filesystem::remove(titlePath);
+}
+
+TEST(JoinTest, TestGraceHashJoinSpillsToDisk) {
+    const auto [castRelation, titleRelation] = createUnsortedRelations(3000, 25);
+    const auto expected = performReferenceJoin(castRelation, titleRelation);
+
+    // The titles take about 1MB; with 128KB most of the 16 partitions end up on disk
+    for (size_t memoryBudget : {size_t{128} * 1024, size_t{1} << 30}) {
+        ResultVector result;
+        const GraceJoinStats stats = performGraceHashJoin(
+            createBatchReader(castRelation), createBatchReader(titleRelation),
+            [&](span<const ResultRelation> results) {
+                result.insert(result.end(), results.begin(), results.end());
+            },
+            {.memoryBudget = memoryBudget, .numPartitions = 16, .ioBufferSize = 4096, .batchSize = 500, .resultBatchSize = 100, .numThreads = 4});
+
+        EXPECT_EQ(stats.castTuples, castRelation.size());
+        EXPECT_EQ(stats.titleTuples, titleRelation.size());
+        EXPECT_EQ(stats.resultTuples, expected.size());
+        EXPECT_EQ(stats.spilledPartitions + stats.residentPartitions, 16u);
+        EXPECT_EQ(stats.bytesReadBack, stats.bytesSpilled);
+        if (memoryBudget < titleRelation.size() * GRACE_BYTES_PER_TITLE) {
+            EXPECT_GT(stats.spilledPartitions, 8u);
+            EXPECT_GT(stats.bytesSpilled, 0u);
+        } else {
+            EXPECT_EQ(stats.spilledPartitions, 0u);
+            EXPECT_EQ(stats.bytesSpilled, 0u);
+        }
+        std::sort(result.begin(), result.end());
+        EXPECT_EQ(result, expected);
+    }
+}
+
+// Sorted relations in which one blockbuster title owns most of the cast tuples
+static pair<RelationVector<CastRelation>, RelationVector<TitleRelation>> createSkewedRelations(int numTitles, int hotTitle, int hotCast) {
+    auto [castRelation, titleRelation] = createSortedRelations(numTitles, 5);
+    const auto hot_begin = std::ranges::lower_bound(castRelation, hotTitle, {}, &CastRelation::movieId);
+    RelationVector<CastRelation> hot(hotCast, CastRelation{});
+    for (int i = 0; i < hotCast; ++i) {
+        hot[i].castInfoId = 1000000 + i;
+        hot[i].personId = i;
+        hot[i].movieId = hotTitle;
+    }
+    castRelation.insert(hot_begin, hot.begin(), hot.end());
+    return {castRelation, titleRelation};
+}
+
+TEST(JoinTest, TestHeavyHitterRunIsSplit) {
+    const auto [castRelation, titleRelation] = createSkewedRelations(1000, 400, 20000);
+    const size_t chunkSize = 500;
+
+    for (auto strategy : {PartitionStrategy::SequentialScan, PartitionStrategy::KeySplitters}) {
+        const auto partitions = splitSkewedPartitions(castKeys(castRelation), titleKeys(titleRelation),
+                                                      strategy == PartitionStrategy::KeySplitters ? partitionRelationsBySplitters(castRelation, titleRelation, chunkSize, 4)
+                                                                                                  : partitionRelations(castRelation, titleRelation, chunkSize),
+                                                      chunkSize);
+        size_t covered = 0;
+        size_t hotPieces = 0;
+        for (const auto& partition : partitions) {
+            EXPECT_LE(partition.castEnd - partition.castBegin, SKEW_SPLIT_FACTOR * chunkSize);
+            covered += partition.castEnd - partition.castBegin;
+            if (castRelation[partition.castBegin].movieId == 400 && castRelation[partition.castEnd - 1].movieId == 400) {
+                hotPieces++;
+                // Every piece of the hot run joins exactly the hot title
+                ASSERT_EQ(partition.titleEnd - partition.titleBegin, 1u);
+                EXPECT_EQ(titleRelation[partition.titleBegin].titleId, 400);
+            }
+        }
+        EXPECT_EQ(covered, castRelation.size());
+        EXPECT_GE(hotPieces, 20000 / chunkSize);
+
+        auto result = performJoin(castRelation, titleRelation, 4, {.partitionStrategy = strategy});
+        std::sort(result.begin(), result.end());
+        EXPECT_EQ(result, performReferenceJoin(castRelation, titleRelation));
+    }
+}
+
+TEST(JoinTest, TestWorkStealingExecutorBalancesSkewedWork) {
+    WorkStealingExecutor executor(4);
+    const size_t size = 20000;
+    vector<std::atomic<int>> visits(size);
+
+    // All expensive items sit in the first worker's block, so the others have to steal or split
+    executor.parallelFor(size, 8, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            visits[i]++;
+            if (i < 2000) {
+                volatile double sink = 0;
+                for (int k = 0; k < 20000; ++k) {
+                    sink = sink + std::sqrt(static_cast<double>(k));
+                }
+            }
+        }
+    });
+
+    EXPECT_TRUE(std::ranges::all_of(visits, [](const std::atomic<int>& count) { return count == 1; }));
+    uint64_t items = 0;
+    uint64_t stolen = 0;
+    for (const WorkerStats& stats : executor.stats()) {
+        items += stats.itemsProcessed;
+        stolen += stats.steals + stats.rangeSplits;
+    }
+    EXPECT_EQ(items, size);
+    EXPECT_GT(stolen, 0u);
+
+    // The join and its count and materialization passes run on the executor
+    executor.resetStats();
+    const auto [castRelation, titleRelation] = createSkewedRelations(1000, 400, 20000);
+    for (auto algorithm : {JoinAlgorithm::SortMerge, JoinAlgorithm::RadixHash}) {
+        auto result = performJoin(castRelation, titleRelation, 4, {.algorithm = algorithm, .executor = &executor});
+        std::sort(result.begin(), result.end());
+        EXPECT_EQ(result, performReferenceJoin(castRelation, titleRelation));
+    }
+    uint64_t tasks = 0;
+    for (const WorkerStats& stats : executor.stats()) {
+        tasks += stats.tasksExecuted;
+    }
+    EXPECT_GT(tasks, 0u);
+}
+
+TEST(JoinTest, TestNumaAwareJoinMatchesReference) {
+    const auto [castRelation, titleRelation] = createSortedRelations(3000, 25);
+    const auto expected = performReferenceJoin(castRelation, titleRelation);
+
+    auto result = performJoin(castRelation, titleRelation, 4, {.numaAware = true});
+    std::sort(result.begin(), result.end());
+    EXPECT_EQ(result, expected);
+
+    auto columnarResult = performJoin(toColumns(castRelation), toColumns(titleRelation), 4, {.numaAware = true});
+    std::sort(columnarResult.begin(), columnarResult.end());
+    EXPECT_EQ(columnarResult, expected);
+
+    EXPECT_EQ(parseCpuList("0-2,5,7-8\n"), (vector<int>{0, 1, 2, 5, 7, 8}));
+    EXPECT_GE(numaTopology().numNodes(), 1);
+}
+
+TEST(JoinTest, TestCacheSizeDetection) {
+    const CacheSizes& caches = cacheSizes();
+    EXPECT_GT(caches.l1d, 0u);
+    EXPECT_GE(caches.l2, caches.l1d);
+    EXPECT_GT(caches.lineSize, 0u);
+    EXPECT_EQ(parseCacheSize("48K"), 48u * 1024);
+    EXPECT_EQ(parseCacheSize("2M"), 2u * 1024 * 1024);
+}
+
+TEST(JoinTest, TestJoinProfileRecordsPhases) {
+    const auto [castRelation, titleRelation] = createSortedRelations(3000, 25);
+    const auto expected = performReferenceJoin(castRelation, titleRelation);
+
+    JoinProfile profile;
+    auto result = performJoin(castRelation, titleRelation, 2, {.profile = &profile});
+    std::sort(result.begin(), result.end());
+    EXPECT_EQ(result, expected);
+
+    const auto [unsortedCast, unsortedTitle] = createUnsortedRelations(2000, 10);
+    performJoin(unsortedCast, unsortedTitle, 2, {.profile = &profile});
+
+    vector<string> names;
+    for (const PhaseProfile& phase : profile.phases()) {
+        names.push_back(phase.name);
+        EXPECT_EQ(phase.threads.size(), 2u);
+        EXPECT_GT(phase.wallTime.count(), 0);
+        if (profile.hardwareCountersAvailable()) {
+            EXPECT_GT(phase.total()[PerfEvent::Instructions], 0u);
+        }
+    }
+    EXPECT_EQ(names, (vector<string>{"partition", "count", "allocate", "join materialize", "sort", "partition", "count", "allocate", "join", "materialize"}));
+    EXPECT_EQ(profile.report().getSnapshots().size(), names.size());
+    EXPECT_EQ(profile.report().getSnapshots()[2].children.size(), 2u);
+
+    std::cout << profile.report() << std::endl;
+    if (!profile.hardwareCountersAvailable()) {
+        std::cout << "perf_event_open is not permitted here, the report only shows times" << std::endl;
+    }
 }
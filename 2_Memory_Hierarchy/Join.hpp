@@ -15,7 +15,184 @@
 #define JOIN_HPP
 
 #include "JoinUtils.hpp"
+#include "ColumnarRelation.hpp"
+#include "Pushdown.hpp"
+#include <cstdint>
+#include <functional>
+#include <span>
 
-std::vector<ResultRelation> performJoin(const std::vector<CastRelation>& leftRelation, const std::vector<TitleRelation>& rightRelation, int numThreads);
+class JoinProfile;
+class WorkStealingExecutor;
+struct PrefilterStats;
+
+// Index range of one join partition inside the (sorted) cast and title relations.
+// Partitions only split the movieId run of a heavy hitter; all pieces of such a run share
+// the title range of that key, so each partition can still be joined independently.
+struct JoinPartition {
+    size_t castBegin;
+    size_t castEnd;
+    size_t titleBegin;
+    size_t titleEnd;
+};
+
+// How performJoin cuts the relations into partitions before the parallel join phase.
+enum class PartitionStrategy {
+    // Walks both relations chunk by chunk and moves every cutoff to a movieId run boundary.
+    SequentialScan,
+    // Samples movieId splitters up front and finds every boundary with an independent binary search.
+    KeySplitters,
+};
+
+// Join engine used by performJoin.
+enum class JoinAlgorithm {
+    // Partitioned merge join. Sorted input (checked in one parallel pass) is merged in place;
+    // otherwise the (key, row id) pairs of the relations are radix sorted and merged first.
+    SortMerge,
+    // Parallel radix partitioned hash join; works on unsorted relations.
+    RadixHash,
+    // Array indexed by titleId, probed with every movieId (DirectAddressJoin.hpp). Needs unique
+    // titleIds from a dense range; otherwise the join falls back to SortMerge.
+    DirectAddress,
+};
+
+// Semi-join filter over the keys of the smaller relation, applied to the larger one before the join
+enum class SemiJoinPrefilter {
+    None,
+    // Register-blocked Bloom filter (SemiJoinFilter.hpp)
+    Bloom,
+    // Exact bitmap over the key range; falls back to Bloom if the range is sparse
+    Bitmap,
+    // Bitmap if the key range is dense, Bloom otherwise
+    Auto,
+};
+
+struct JoinOptions {
+    JoinAlgorithm algorithm = JoinAlgorithm::SortMerge;
+    // Only used by JoinAlgorithm::SortMerge.
+    PartitionStrategy partitionStrategy = PartitionStrategy::KeySplitters;
+    // Spreads movieId runs larger than one chunk over several partitions (JoinAlgorithm::SortMerge only).
+    bool splitHeavyHitters = true;
+    // Runs the count, join and materialization passes on this executor instead of OpenMP loops;
+    // its per-thread counters then show how the work was balanced.
+    WorkStealingExecutor* executor = nullptr;
+    // Pins the join threads to the NUMA nodes in contiguous blocks; every thread writes its output
+    // slots first, so their pages are allocated on its node (sort-merge join of sorted input only).
+    // The loader interleaves the input relations over the nodes. A no-op on single-node machines.
+    bool numaAware = false;
+    // Cast tuples per sort-merge partition; 0 derives it from the detected L2 size (CacheInfo.hpp).
+    size_t castChunkSize = 0;
+    // Records wall time and hardware counters per join phase and thread (PerfCounters.hpp). The
+    // sort-merge join of sorted relations merges and writes its result in one "join materialize" phase.
+    JoinProfile* profile = nullptr;
+    // Drops tuples without a join partner before partitioning or sorting. The join then runs on
+    // the row ids of the remaining tuples, like performLateMaterializedJoin, and materializes them
+    // in a separate pass: numaAware and the fused "join materialize" phase are not used.
+    SemiJoinPrefilter prefilter = SemiJoinPrefilter::None;
+    // Receives the filter size and selectivity of the prefilter.
+    PrefilterStats* prefilterStats = nullptr;
+};
+
+std::vector<JoinPartition> partitionRelations(const RelationVector<CastRelation>& castRelation, const RelationVector<TitleRelation>& titleRelation, size_t castChunkSize);
+
+std::vector<JoinPartition> partitionRelationsBySplitters(const RelationVector<CastRelation>& castRelation, const RelationVector<TitleRelation>& titleRelation, size_t castChunkSize, int numThreads);
+
+size_t countJoinThread(std::span<const CastRelation> castRelation, std::span<const TitleRelation> titleRelation);
+
+size_t performJoinThread(std::span<const CastRelation> castRelation, std::span<const TitleRelation> titleRelation, ResultRelation* output);
+
+ResultVector performJoin(const RelationVector<CastRelation>& leftRelation, const RelationVector<TitleRelation>& rightRelation, int numThreads, const JoinOptions& options = {});
+
+// Columnar variant: the merge runs over the movieId/titleId key columns only and reads the
+// payload columns when a match is materialized.
+ResultVector performJoin(const CastColumns& leftRelation, const TitleColumns& rightRelation, int numThreads, const JoinOptions& options = {});
+
+// Row ids of one matching cast/title pair, produced by the late materialization join.
+struct JoinIndexPair {
+    uint32_t castIndex;
+    uint32_t titleIndex;
+};
+
+using JoinIndexVector = UninitializedVector<JoinIndexPair>;
+
+// Result of performLateMaterializedJoin: keeps only the matching row ids and builds
+// result tuples or single columns from the input relations when they are accessed.
+// The input relations have to outlive the view.
+class JoinResultView {
+  public:
+    JoinResultView(const RelationVector<CastRelation>& castRelation, const RelationVector<TitleRelation>& titleRelation, JoinIndexVector indexPairs)
+        : castRelation(&castRelation), titleRelation(&titleRelation), indexPairs(std::move(indexPairs)) {}
+
+    [[nodiscard]] size_t size() const { return indexPairs.size(); }
+    [[nodiscard]] bool empty() const { return indexPairs.empty(); }
+    [[nodiscard]] const JoinIndexVector& getIndexPairs() const { return indexPairs; }
+
+    [[nodiscard]] const CastRelation& cast(size_t i) const { return (*castRelation)[indexPairs[i].castIndex]; }
+    [[nodiscard]] const TitleRelation& title(size_t i) const { return (*titleRelation)[indexPairs[i].titleIndex]; }
+
+    // Reads a single column of the i-th result, e.g. view.castColumn(i, &CastRelation::personId)
+    template <typename Column>
+    [[nodiscard]] const Column& castColumn(size_t i, Column CastRelation::*column) const { return cast(i).*column; }
+
+    template <typename Column>
+    [[nodiscard]] const Column& titleColumn(size_t i, Column TitleRelation::*column) const { return title(i).*column; }
+
+    [[nodiscard]] ResultRelation operator[](size_t i) const { return createResultTuple(cast(i), title(i)); }
+
+    [[nodiscard]] ResultVector materialize() const {
+        ResultVector result;
+        result.reserve(indexPairs.size());
+        for (size_t i = 0; i < indexPairs.size(); ++i) {
+            result.push_back((*this)[i]);
+        }
+        return result;
+    }
+
+  private:
+    const RelationVector<CastRelation>* castRelation;
+    const RelationVector<TitleRelation>* titleRelation;
+    JoinIndexVector indexPairs;
+};
+
+JoinResultView performLateMaterializedJoin(const RelationVector<CastRelation>& castRelation, const RelationVector<TitleRelation>& titleRelation, int numThreads, const JoinOptions& options = {});
+
+// Row ids of all matches of two columnar relations; payloads are never touched.
+JoinIndexVector performJoinIndices(const CastColumns& castRelation, const TitleColumns& titleRelation, int numThreads, const JoinOptions& options = {});
+
+// Join with the predicates and projections of query pushed into it: the predicates select the
+// input rows before the join, the join runs on the row ids of the selected tuples only, and just
+// the projected columns of the matches are written.
+ProjectedJoinResult performProjectedJoin(const RelationVector<CastRelation>& castRelation, const RelationVector<TitleRelation>& titleRelation, const JoinQuery& query,
+                                         int numThreads, const JoinOptions& options = {});
+
+// Streaming join over sorted inputs that do not fit into memory. A reader appends up to maxTuples
+// tuples (in join key order) to batch and returns how many it appended; 0 ends the stream.
+using CastBatchReader = std::function<size_t(RelationVector<CastRelation>& batch, size_t maxTuples)>;
+using TitleBatchReader = std::function<size_t(RelationVector<TitleRelation>& batch, size_t maxTuples)>;
+// Receives the join result batch by batch; the span is only valid during the call.
+using ResultSink = std::function<void(std::span<const ResultRelation> results)>;
+
+struct StreamingJoinOptions {
+    // Tuples requested from a reader per call
+    size_t batchSize = 1 << 20;
+    // Maximum number of result tuples per sink call
+    size_t resultBatchSize = 1 << 16;
+    // Threads used to join the buffered batches
+    int numThreads = 1;
+};
+
+struct StreamingJoinStats {
+    size_t castTuples = 0;
+    size_t titleTuples = 0;
+    size_t resultTuples = 0;
+    // Largest number of cast plus title tuples that were buffered at the same time
+    size_t peakBufferedTuples = 0;
+    // False if an input turned out not to be sorted by its join key; the join stops there
+    bool sortedInput = true;
+};
+
+// Joins two sorted streams batch by batch. Only the current batches, the open key run at the end
+// of each batch (which may continue in the next one) and the results of one batch are held in
+// memory, so memory is bounded by the batch size and the longest key run, not by the input size.
+StreamingJoinStats performStreamingJoin(const CastBatchReader& castReader, const TitleBatchReader& titleReader, const ResultSink& sink, const StreamingJoinOptions& options = {});
 
 #endif // JOIN_HPP
\ No newline at end of file
@@ -0,0 +1,178 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef JOINAGGREGATION_HPP
+#define JOINAGGREGATION_HPP
+
+#include "Join.hpp"
+#include "Pushdown.hpp"
+#include "RadixHashJoin.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+//==--------------------------------------------------------------------==//
+//==------------------- FUSED JOIN + GROUP BY AGGREGATION --------------==//
+//==--------------------------------------------------------------------==//
+
+// Integer column of one of the join inputs
+struct JoinColumn {
+    bool fromCast;
+    size_t field;
+
+    [[nodiscard]] static JoinColumn cast(CastField field) { return {true, static_cast<size_t>(field)}; }
+    [[nodiscard]] static JoinColumn title(TitleField field) { return {false, static_cast<size_t>(field)}; }
+};
+
+// GROUP BY groupBy with COUNT(*) and SUM, MIN and MAX of value over the join result
+struct AggregationQuery {
+    JoinColumn groupBy;
+    // Without a value column only the count is computed; sum, min and max stay 0
+    std::optional<JoinColumn> value;
+};
+
+struct GroupAggregate {
+    int32_t key;
+    uint64_t count = 0;
+    int64_t sum = 0;
+    int32_t min = INT32_MAX;
+    int32_t max = INT32_MIN;
+
+    void add(const GroupAggregate& other) {
+        count += other.count;
+        sum += other.sum;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+    }
+
+    bool operator==(const GroupAggregate&) const = default;
+};
+
+// Start capacity of an aggregation table; it doubles whenever it is half full
+static constexpr size_t AGGREGATION_TABLE_CAPACITY = 1024;
+// Smallest start capacity of the table of one merge part
+static constexpr size_t AGGREGATION_PART_MIN_CAPACITY = 16;
+
+// Open addressing (linear probing) hash table from group key to its running aggregate
+class AggregationTable {
+  public:
+    // capacity has to be a power of two
+    explicit AggregationTable(size_t capacity = AGGREGATION_TABLE_CAPACITY) : slots(capacity), used(capacity, 0) {}
+
+    // Adds count matches of one group whose value sum, min and max are given by partial
+    void add(const GroupAggregate& partial) {
+        if (2 * (groups + 1) > slots.size()) {
+            grow();
+        }
+        const size_t mask = slots.size() - 1;
+        for (size_t slot = radixHash(partial.key) & mask;; slot = (slot + 1) & mask) {
+            if (!used[slot]) {
+                used[slot] = 1;
+                slots[slot] = partial;
+                groups++;
+                return;
+            }
+            if (slots[slot].key == partial.key) {
+                slots[slot].add(partial);
+                return;
+            }
+        }
+    }
+
+    [[nodiscard]] size_t size() const { return groups; }
+
+    template <typename Visit>
+    void forEach(Visit&& visit) const {
+        for (size_t slot = 0; slot < slots.size(); ++slot) {
+            if (used[slot]) {
+                visit(slots[slot]);
+            }
+        }
+    }
+
+  private:
+    void grow() {
+        const std::vector<GroupAggregate> old_slots = std::move(slots);
+        const std::vector<uint8_t> old_used = std::move(used);
+        slots.assign(2 * old_slots.size(), {});
+        used.assign(2 * old_slots.size(), 0);
+        groups = 0;
+        for (size_t slot = 0; slot < old_slots.size(); ++slot) {
+            if (old_used[slot]) {
+                add(old_slots[slot]);
+            }
+        }
+    }
+
+    std::vector<GroupAggregate> slots;
+    std::vector<uint8_t> used;
+    size_t groups = 0;
+};
+
+// Merge part of a group key; the high hash bits pick the part, the tables probe with the low bits
+inline size_t aggregationPart(int32_t key, size_t parts) {
+    return static_cast<size_t>(static_cast<uint64_t>(radixHash(key)) * parts >> 32);
+}
+
+// Aggregation state of one thread of the fused join, split into one table per merge part. Every
+// thread owns one, so adding a match needs no synchronization.
+class PartitionedAggregationTable {
+  public:
+    explicit PartitionedAggregationTable(size_t parts)
+        : tables(parts, AggregationTable(std::bit_ceil(std::max(AGGREGATION_TABLE_CAPACITY / parts, AGGREGATION_PART_MIN_CAPACITY)))) {}
+
+    void add(const GroupAggregate& partial) { tables[aggregationPart(partial.key, tables.size())].add(partial); }
+
+    [[nodiscard]] size_t numParts() const { return tables.size(); }
+    [[nodiscard]] const AggregationTable& part(size_t part) const { return tables[part]; }
+
+  private:
+    std::vector<AggregationTable> tables;
+};
+
+// Merges the per-thread tables in parallel: part p only combines the p-th table of every thread,
+// so every group is read once. Returns the groups sorted by key.
+inline std::vector<GroupAggregate> mergeAggregationTables(const std::vector<PartitionedAggregationTable>& tables, int numThreads) {
+    const size_t parts = tables.empty() ? 0 : tables.front().numParts();
+    std::vector<std::vector<GroupAggregate>> merged(parts);
+
+#pragma omp parallel for schedule(dynamic) num_threads(numThreads) shared(tables, merged)
+    for (size_t part = 0; part < parts; ++part) {
+        AggregationTable table = tables.front().part(part);
+        for (size_t thread = 1; thread < tables.size(); ++thread) {
+            tables[thread].part(part).forEach([&](const GroupAggregate& group) { table.add(group); });
+        }
+        merged[part].reserve(table.size());
+        table.forEach([&](const GroupAggregate& group) { merged[part].push_back(group); });
+    }
+
+    std::vector<GroupAggregate> result;
+    for (const auto& part : merged) {
+        result.insert(result.end(), part.begin(), part.end());
+    }
+    std::ranges::sort(result, {}, &GroupAggregate::key);
+    return result;
+}
+
+// Joins the relations with the algorithm of options and aggregates every match straight into
+// per-thread aggregation tables, which are merged at the end; no join result is materialized.
+// Sort-merge runs whose group and value come from the title tuple are added in one step.
+// Returns no groups if a column of the query is not an integer field.
+std::vector<GroupAggregate> performJoinAggregation(const RelationVector<CastRelation>& castRelation, const RelationVector<TitleRelation>& titleRelation,
+                                                   const AggregationQuery& query, int numThreads, const JoinOptions& options = {});
+
+#endif // JOINAGGREGATION_HPP
@@ -0,0 +1,248 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "Join.hpp"
+#include "DataGenerator.hpp"
+#include "NumaPlacement.hpp"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Run with --benchmark_out=<file> --benchmark_out_format=json (or build the
+// <project>_benchmark_json target) to get results that can be compared between releases.
+
+using std::vector;
+
+//==--------------------------------------------------------------------==//
+//==------------------------- INPUT GENERATION -------------------------==//
+//==--------------------------------------------------------------------==//
+
+// Inputs of the join benchmarks; all of them are generated by DataGenerators/DataGenerator.hpp
+enum class BenchmarkInput : int64_t {
+    // Uniform keys, half of the cast tuples match a title
+    Uniform,
+    // Title ranks drawn with Zipf exponent 1, so a few titles get most of the cast tuples
+    Zipf,
+    // Uniform keys, every cast tuple matches
+    AllMatch,
+    // All keys lie above the title range
+    NoMatch,
+};
+
+static const char* inputName(BenchmarkInput input) {
+    switch (input) {
+    case BenchmarkInput::Uniform: return "uniform";
+    case BenchmarkInput::Zipf: return "zipf";
+    case BenchmarkInput::AllMatch: return "all_match";
+    case BenchmarkInput::NoMatch: return "no_match";
+    }
+    return "unknown";
+}
+
+// Average number of cast tuples per title
+static constexpr size_t CAST_PER_TITLE = 4;
+
+// Generator options of sorted relations, like the IMDB files, with castSize cast tuples
+static GeneratorOptions generatorOptions(size_t castSize, BenchmarkInput input) {
+    GeneratorOptions options;
+    options.castRows = castSize;
+    options.titleRows = std::max<size_t>(castSize / CAST_PER_TITLE, 1);
+    options.distribution = input == BenchmarkInput::Zipf ? KeyDistribution::Zipf : KeyDistribution::Uniform;
+    options.matchRatio = input == BenchmarkInput::Uniform ? 0.5 : input == BenchmarkInput::NoMatch ? 0.0 : 1.0;
+    return options;
+}
+
+// Relations are generated once per size and input and shared by all thread counts
+static const std::pair<RelationVector<CastRelation>, RelationVector<TitleRelation>>& cachedRelations(size_t castSize, BenchmarkInput input) {
+    static std::map<std::pair<size_t, BenchmarkInput>, std::pair<RelationVector<CastRelation>, RelationVector<TitleRelation>>> cache;
+    const auto key = std::make_pair(castSize, input);
+    auto it = cache.find(key);
+    if (it == cache.end()) {
+        it = cache.emplace(key, generateRelationsInMemory(generatorOptions(castSize, input))).first;
+    }
+    return it->second;
+}
+
+template <typename Relation, typename ToString>
+static std::string writeCsv(const std::string& name, const RelationVector<Relation>& relation, ToString&& toString) {
+    const std::string path = (std::filesystem::temp_directory_path() / name).string();
+    std::ofstream file(path, std::ios::trunc);
+    file << "header\n";
+    for (const Relation& tuple : relation) {
+        file << toString(tuple) << '\n';
+    }
+    return path;
+}
+
+// CSV files of the uniform relations, written on first use and removed at exit
+static const std::string& cachedCsv(size_t castSize, bool cast) {
+    struct Files {
+        std::map<std::pair<size_t, bool>, std::string> paths;
+        ~Files() {
+            for (const auto& [key, path] : paths) {
+                std::error_code error;
+                std::filesystem::remove(path, error);
+            }
+        }
+    };
+    static Files files;
+    const auto key = std::make_pair(castSize, cast);
+    auto it = files.paths.find(key);
+    if (it == files.paths.end()) {
+        const auto& [castRelation, titleRelation] = cachedRelations(castSize, BenchmarkInput::Uniform);
+        const std::string suffix = std::to_string(castSize) + "_" + std::to_string(getpid()) + ".csv";
+        const std::string path = cast ? writeCsv("ppds_benchmark_cast_" + suffix, castRelation, castRelationToString)
+                                      : writeCsv("ppds_benchmark_title_" + suffix, titleRelation, titleRelationToString);
+        it = files.paths.emplace(key, path).first;
+    }
+    return it->second;
+}
+
+//==--------------------------------------------------------------------==//
+//==---------------------------- BENCHMARKS ----------------------------==//
+//==--------------------------------------------------------------------==//
+
+// Thread counts 1, 2, 4, ... up to and including the number of hardware threads
+static vector<int64_t> threadCounts() {
+    const auto max_threads = static_cast<int64_t>(std::max(std::thread::hardware_concurrency(), 1u));
+    vector<int64_t> counts;
+    for (int64_t threads = 1; threads < max_threads; threads *= 2) {
+        counts.push_back(threads);
+    }
+    counts.push_back(max_threads);
+    return counts;
+}
+
+// Arguments: number of threads, cast tuples, input
+static void BM_PerformJoin(benchmark::State& state) {
+    const int numThreads = static_cast<int>(state.range(0));
+    const auto castSize = static_cast<size_t>(state.range(1));
+    const auto input = static_cast<BenchmarkInput>(state.range(2));
+    const auto& [castRelation, titleRelation] = cachedRelations(castSize, input);
+    state.SetLabel(inputName(input));
+
+    size_t result_size = 0;
+    for (auto _ : state) {
+        ResultVector result = performJoin(castRelation, titleRelation, numThreads);
+        result_size = result.size();
+        benchmark::DoNotOptimize(result.data());
+        benchmark::ClobberMemory();
+    }
+    const auto input_tuples = static_cast<int64_t>(castRelation.size() + titleRelation.size());
+    state.SetItemsProcessed(state.iterations() * input_tuples);
+    state.counters["result_tuples"] = static_cast<double>(result_size);
+}
+BENCHMARK(BM_PerformJoin)
+    ->ArgNames({"threads", "cast_tuples", "input"})
+    ->ArgsProduct({threadCounts(),
+                   benchmark::CreateRange(1 << 14, 1 << 20, 8),
+                   {static_cast<int64_t>(BenchmarkInput::Uniform), static_cast<int64_t>(BenchmarkInput::Zipf),
+                    static_cast<int64_t>(BenchmarkInput::AllMatch), static_cast<int64_t>(BenchmarkInput::NoMatch)}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Sort-merge join with a fixed cast chunk size per partition; chunk size 0 is the size derived
+// from the detected L2 (CacheInfo.hpp). Arguments: number of threads, chunk size, cast tuples
+static void BM_JoinChunkSize(benchmark::State& state) {
+    const int numThreads = static_cast<int>(state.range(0));
+    const auto chunkSize = static_cast<size_t>(state.range(1));
+    const auto& [castRelation, titleRelation] = cachedRelations(static_cast<size_t>(state.range(2)), BenchmarkInput::Uniform);
+    if (chunkSize == 0) {
+        state.SetLabel("auto");
+    }
+
+    for (auto _ : state) {
+        ResultVector result = performJoin(castRelation, titleRelation, numThreads, {.castChunkSize = chunkSize});
+        benchmark::DoNotOptimize(result.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(castRelation.size() + titleRelation.size()));
+}
+BENCHMARK(BM_JoinChunkSize)
+    ->ArgNames({"threads", "chunk_size", "cast_tuples"})
+    ->ArgsProduct({{1, threadCounts().back()}, {0, 64, 256, 1024, 4096, 16384, 65536, 262144}, {1 << 20}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Arguments: number of threads, cast tuples of the generated file. The "MB" counter is the CSV
+// throughput in MB/s.
+template <typename Relation>
+static void BM_Load(benchmark::State& state) {
+    constexpr bool is_cast = std::is_same_v<Relation, CastRelation>;
+    const int numThreads = static_cast<int>(state.range(0));
+    const std::string& path = cachedCsv(static_cast<size_t>(state.range(1)), is_cast);
+    const auto file_size = static_cast<int64_t>(std::filesystem::file_size(path));
+
+    for (auto _ : state) {
+        RelationVector<Relation> relation = load<Relation>(path, SIZE_MAX, numThreads);
+        benchmark::DoNotOptimize(relation.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * file_size);
+    state.counters["MB"] = benchmark::Counter(static_cast<double>(file_size) / 1e6, benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(BM_Load<CastRelation>)
+    ->ArgNames({"threads", "cast_tuples"})
+    ->ArgsProduct({threadCounts(), {1 << 20}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK(BM_Load<TitleRelation>)
+    ->ArgNames({"threads", "cast_tuples"})
+    ->ArgsProduct({threadCounts(), {1 << 20}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Read bandwidth of one thread pinned to node 0 over a buffer placed on the given node; the run
+// on the last node shows the remote penalty. Argument: memory node
+static void BM_NumaReadBandwidth(benchmark::State& state) {
+    const int memoryNode = static_cast<int>(state.range(0));
+    const size_t size = (size_t{64} << 20) / sizeof(uint64_t);
+    vector<uint64_t> buffer(size, 1);
+    placeOnNode(buffer.data(), size * sizeof(uint64_t), memoryNode);
+    state.SetLabel(memoryNode == 0 ? "local" : "remote");
+
+    cpu_set_t previous_affinity;
+    const bool restore = sched_getaffinity(0, sizeof(previous_affinity), &previous_affinity) == 0;
+    pinThreadToNode(0, 1);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(std::accumulate(buffer.begin(), buffer.end(), uint64_t{0}));
+    }
+    if (restore) {
+        sched_setaffinity(0, sizeof(previous_affinity), &previous_affinity);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(size * sizeof(uint64_t)));
+}
+
+// Node 0 and, on NUMA machines, the last node
+static vector<int64_t> memoryNodes() {
+    vector<int64_t> nodes = {0};
+    if (numaTopology().isNuma()) {
+        nodes.push_back(numaTopology().numNodes() - 1);
+    }
+    return nodes;
+}
+BENCHMARK(BM_NumaReadBandwidth)
+    ->ArgName("memory_node")
+    ->ArgsProduct({memoryNodes()})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -15,11 +15,27 @@
 #ifndef JOINUTIL_HPP
 #define JOINUTIL_HPP
 
+#include "NumaPlacement.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
 #include <cstring>
-#include <fstream>
 #include <sstream>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <tuple>
+#include <utility>
 #include <vector>
+#include <fcntl.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 //==--------------------------------------------------------------------==//
 //==------------------ RELATION & RELATION UTILITY----------------------==//
@@ -119,20 +135,60 @@ static constexpr size_t NUM_FIELD_CAST_RELATION = 7;
       return lhs.roleId < rhs.roleId; // Last comparison to fully define the ordering
     }
 
+    // Allocator that default-initializes instead of value-initializing, so sizing a vector of plain
+    // tuples does not write them and the parallel pass that fills them is the first touch
+    template <typename T>
+    struct DefaultInitAllocator : std::allocator<T> {
+      template <typename U>
+      struct rebind {
+        using other = DefaultInitAllocator<U>;
+      };
+
+      DefaultInitAllocator() = default;
+      template <typename U>
+      DefaultInitAllocator(const DefaultInitAllocator<U>&) noexcept {}
+
+      template <typename U>
+      void construct(U* pointer) noexcept(std::is_nothrow_default_constructible_v<U>) {
+        ::new (static_cast<void*>(pointer)) U;
+      }
+      template <typename U, typename... Args>
+      void construct(U* pointer, Args&&... args) {
+        ::new (static_cast<void*>(pointer)) U(std::forward<Args>(args)...);
+      }
+    };
+
+    template <typename T>
+    using UninitializedVector = std::vector<T, DefaultInitAllocator<T>>;
+
+    // Join result whose slots are only written by the materialization
+    using ResultVector = UninitializedVector<ResultRelation>;
+
+    // Rows of a loaded relation; sizing it leaves the rows unwritten, so the parallel parse is
+    // their first touch
+    template <typename Relation>
+    using RelationVector = UninitializedVector<Relation>;
+
+    // Text of a fixed size string field; fields filled to the last byte (e.g. md5sum) have no terminator
+    template <size_t Size>
+    [[nodiscard]] inline std::string_view fieldText(const char (&field)[Size]) {
+      return {field, strnlen(field, Size)};
+    }
+
     [[nodiscard]] inline std::string titleRelationToString(const TitleRelation& relation) {
       std::ostringstream oss;
       oss<< relation.titleId << ","
-          << relation.title << ","
-          << relation.imdbIndex << ","
+          << fieldText(relation.title) << ","
+          << fieldText(relation.imdbIndex) << ","
           << relation.kindId << ","
           << relation.productionYear << ","
           << relation.imdbId << ","
-          << relation.phoneticCode << ","
+          << fieldText(relation.phoneticCode) << ","
           << relation.episodeOfId << ","
           << relation.seasonNr << ","
           << relation.episodeNr << ","
-          << relation.seriesYears << ","
-          << relation.md5sum;
+          << fieldText(relation.seriesYears) << ","
+          << fieldText(relation.md5sum);
 
       return oss.str();
     }
@@ -143,7 +199,7 @@ static constexpr size_t NUM_FIELD_CAST_RELATION = 7;
           << relation.personId << ","
           << relation.movieId << ","
           << relation.personRoleId << ","
-          << relation.note << ","
+          << fieldText(relation.note) << ","
           << relation.nrOrder << ","
           << relation.roleId;
 
@@ -153,56 +209,68 @@ static constexpr size_t NUM_FIELD_CAST_RELATION = 7;
     [[nodiscard]] inline std::string resultRelationToString(const ResultRelation& relation) {
       std::ostringstream oss;
       oss << relation.titleId << ","
-          << relation.title << ","
-          << relation.imdbIndex << ","
+          << fieldText(relation.title) << ","
+          << fieldText(relation.imdbIndex) << ","
           << relation.kindId << ","
           << relation.productionYear << ","
           << relation.imdbId << ","
-          << relation.phoneticCode << ","
+          << fieldText(relation.phoneticCode) << ","
           << relation.episodeOfId << ","
           << relation.seasonNr << ","
           << relation.episodeNr << ","
-          << relation.seriesYears << ","
-          << relation.md5sum << ","
+          << fieldText(relation.seriesYears) << ","
+          << fieldText(relation.md5sum) << ","
           << relation.castInfoId << ","
           << relation.personId << ","
           << relation.movieId << ","
           << relation.personRoleId << ","
-          << relation.note << ","
+          << fieldText(relation.note) << ","
           << relation.nrOrder << ","
           << relation.roleId;
 
       return oss.str();
     }
 
-    inline void assignValueFromString(TitleRelation& titleRelation, const std::string& value, const size_t fieldIndex) {
+    // Copies a CSV field with strncpy semantics: at most Size bytes, the rest of the array is zero padded
+    template <size_t Size>
+    inline void copyField(char (&target)[Size], std::string_view value) {
+      const size_t length = std::min(value.size(), Size);
+      std::memcpy(target, value.data(), length);
+      std::memset(target + length, 0, Size - length);
+    }
+
+    inline bool parseInt(int32_t& target, std::string_view value) {
+      return std::from_chars(value.data(), value.data() + value.size(), target).ec == std::errc();
+    }
+
+    inline bool assignValueFromString(TitleRelation& titleRelation, std::string_view value, const size_t fieldIndex) {
       switch (fieldIndex) {
-      case 0: titleRelation.titleId = std::stoi(value); break;
-      case 1: std::memcpy(titleRelation.title, value.c_str(), 200); break;
-      case 2: std::memcpy(titleRelation.imdbIndex, value.c_str(), 12); break;
-      case 3: titleRelation.kindId = std::stoi(value); break;
-      case 4: titleRelation.productionYear = std::stoi(value); break;
-      case 5: titleRelation.imdbId = std::stoi(value); break;
-      case 6: std::memcpy(titleRelation.phoneticCode, value.c_str(), 5); break;
-      case 7: titleRelation.episodeOfId = std::stoi(value); break;
-      case 8: titleRelation.seasonNr = std::stoi(value); break;
-      case 9: titleRelation.episodeNr = std::stoi(value); break;
-      case 10: std::memcpy(titleRelation.seriesYears, value.c_str(), 49); break;
-      case 11: std::memcpy(titleRelation.md5sum, value.c_str(), 32); break;
-      default: break;
+      case 0: return parseInt(titleRelation.titleId, value);
+      case 1: copyField(titleRelation.title, value); return true;
+      case 2: copyField(titleRelation.imdbIndex, value); return true;
+      case 3: return parseInt(titleRelation.kindId, value);
+      case 4: return parseInt(titleRelation.productionYear, value);
+      case 5: return parseInt(titleRelation.imdbId, value);
+      case 6: copyField(titleRelation.phoneticCode, value); return true;
+      case 7: return parseInt(titleRelation.episodeOfId, value);
+      case 8: return parseInt(titleRelation.seasonNr, value);
+      case 9: return parseInt(titleRelation.episodeNr, value);
+      case 10: copyField(titleRelation.seriesYears, value); return true;
+      case 11: copyField(titleRelation.md5sum, value); return true;
+      default: return false;
       }
     }
 
-    inline void assignValueFromString(CastRelation& castRelation, const std::string& value, const size_t fieldIndex) {
+    inline bool assignValueFromString(CastRelation& castRelation, std::string_view value, const size_t fieldIndex) {
       switch (fieldIndex) {
-      case 0: castRelation.castInfoId = std::stoi(value); break;
-      case 1: castRelation.personId = std::stoi(value); break;
-      case 2: castRelation.movieId = std::stoi(value); break;
-      case 3: castRelation.personRoleId = std::stoi(value); break;
-      case 4: std::memcpy(castRelation.note, value.c_str(), 100); break;
-      case 5: castRelation.nrOrder = std::stoi(value); break;
-      case 6: castRelation.roleId = std::stoi(value); break;
-      default: break;
+      case 0: return parseInt(castRelation.castInfoId, value);
+      case 1: return parseInt(castRelation.personId, value);
+      case 2: return parseInt(castRelation.movieId, value);
+      case 3: return parseInt(castRelation.personRoleId, value);
+      case 4: copyField(castRelation.note, value); return true;
+      case 5: return parseInt(castRelation.nrOrder, value);
+      case 6: return parseInt(castRelation.roleId, value);
+      default: return false;
       }
     }
 
@@ -210,21 +278,93 @@ static constexpr size_t NUM_FIELD_CAST_RELATION = 7;
     //==--------------------- DATASET LOADING LOGIC ------------------------==//
     //==--------------------------------------------------------------------==//
 
-    inline bool parseLine(const std::string& line, TitleRelation& record) {
-      std::istringstream ss(line);
-      std::string field;
-      size_t fieldIndex = 0;
+    // Read-only memory mapping of a whole file. The loader parses straight out of the
+    // page cache instead of copying every line into a std::string first. A writable mapping is
+    // private: its pages are shared with the page cache until they are written, and writes never
+    // reach the file.
+    class MappedFile {
+     public:
+      explicit MappedFile(const std::string& filename, bool writable = false) {
+        const int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+          return;
+        }
+        struct stat fileStat{};
+        if (fstat(fd, &fileStat) == 0) {
+          fileSize = static_cast<size_t>(fileStat.st_size);
+          if (fileSize == 0) {
+            opened = true;
+          } else if (void* mapping = mmap(nullptr, fileSize, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0); mapping != MAP_FAILED) {
+            madvise(mapping, fileSize, MADV_SEQUENTIAL);
+            fileData = static_cast<char*>(mapping);
+            this->writable = writable;
+            opened = true;
+          }
+        }
+        close(fd);
+      }
+
+      ~MappedFile() {
+        if (fileData != nullptr) {
+          munmap(fileData, fileSize);
+        }
+      }
+
+      MappedFile(const MappedFile&) = delete;
+      MappedFile& operator=(const MappedFile&) = delete;
+
+      [[nodiscard]] bool isOpen() const { return opened; }
+      [[nodiscard]] const char* data() const { return fileData; }
+      // nullptr unless the file was mapped writable
+      [[nodiscard]] char* writableData() const { return writable ? fileData : nullptr; }
+      [[nodiscard]] size_t size() const { return fileSize; }
 
-      while (std::getline(ss, field, ',')) {
-        if (fieldIndex >= NUM_FIELDS_TITLE_RELATION) {
+     private:
+      char* fileData = nullptr;
+      size_t fileSize = 0;
+      bool writable = false;
+      bool opened = false;
+    };
+
+    // Start of the line following position (memchr scans for the newline with SIMD)
+    inline const char* nextLine(const char* position, const char* end) {
+      const auto* newline = static_cast<const char*>(std::memchr(position, '\n', end - position));
+      return newline != nullptr ? newline + 1 : end;
+    }
+
+    // Number of lines in [position, end), counting at most limit lines
+    inline size_t countLines(const char* position, const char* end, const size_t limit) {
+      size_t lines = 0;
+      while (position < end && lines < limit) {
+        position = nextLine(position, end);
+        lines++;
+      }
+      return lines;
+    }
+
+    // Splits a line at the commas and assigns every field without allocating
+    template <typename Relation>
+    bool parseFields(std::string_view line, Relation& record, const size_t numberOfFields) {
+      size_t fieldIndex = 0;
+      while (true) {
+        const auto* delimiter = static_cast<const char*>(std::memchr(line.data(), ',', line.size()));
+        const size_t length = delimiter != nullptr ? static_cast<size_t>(delimiter - line.data()) : line.size();
+        if (fieldIndex >= numberOfFields) {
           std::cerr << "Error: Too many fields in CSV line" << std::endl;
           return false;
         }
-        assignValueFromString(record, field, fieldIndex);
+        if (!assignValueFromString(record, line.substr(0, length), fieldIndex)) {
+          std::cerr << "Error: Invalid value in CSV field " << fieldIndex << std::endl;
+          return false;
+        }
         fieldIndex++;
+        if (delimiter == nullptr) {
+          break;
+        }
+        line.remove_prefix(length + 1);
       }
 
-      if (fieldIndex != NUM_FIELDS_TITLE_RELATION) {
+      if (fieldIndex != numberOfFields) {
         std::cerr << "Error: Too few fields in CSV line" << std::endl;
         return false;
       }
@@ -232,70 +372,302 @@ static constexpr size_t NUM_FIELD_CAST_RELATION = 7;
       return true;
     }
 
-    inline bool parseLine(const std::string& line, CastRelation& record) {
-      std::istringstream ss(line);
-      std::string field;
-      size_t fieldIndex = 0;
+    inline bool parseLine(std::string_view line, TitleRelation& record) {
+      return parseFields(line, record, NUM_FIELDS_TITLE_RELATION);
+    }
 
-      while (std::getline(ss, field, ',')) {
-        if (fieldIndex >= NUM_FIELD_CAST_RELATION) {
-          std::cerr << "Error: Too many fields in CSV line" << std::endl;
+    inline bool parseLine(std::string_view line, CastRelation& record) {
+      return parseFields(line, record, NUM_FIELD_CAST_RELATION);
+    }
+
+    // Threads used by load when no thread count is given
+    inline int defaultLoadThreads() {
+#ifdef _OPENMP
+      return omp_get_max_threads();
+#else
+      return 1;
+#endif
+    }
+
+    // Parses one line into row index of data; std::vector rows are parsed in place, other
+    // containers (e.g. CastColumns) receive the parsed row through set(index, row)
+    template <typename Relation, typename Container>
+    bool parseLineInto(std::string_view line, Container& data, const size_t index) {
+      if constexpr (std::is_same_v<Container, RelationVector<Relation>>) {
+        return parseLine(line, data[index]);
+      } else {
+        Relation record;
+        if (!parseLine(line, record)) {
           return false;
         }
-        assignValueFromString(record, field, fieldIndex);
-        fieldIndex++;
+        data.set(index, record);
+        return true;
+      }
+    }
+
+    template <typename Relation, typename Container>
+    void moveRow(Container& data, const size_t to, const size_t from) {
+      if constexpr (std::is_same_v<Container, RelationVector<Relation>>) {
+        data[to] = data[from];
+      } else {
+        data.set(to, data[from]);
       }
+    }
 
-      if (fieldIndex != NUM_FIELD_CAST_RELATION) {
-        std::cerr << "Error: Too few fields in CSV line" << std::endl;
-        return false;
+    // Interleaves the pages of freshly sized, untouched rows over the NUMA nodes, so that the parse
+    // allocates them there and a join reads them at the bandwidth of all nodes, wherever its
+    // threads run. Columnar containers interleave every column. A no-op on single-node machines.
+    template <typename Relation, typename Container>
+    void interleaveRows(const Container& data) {
+      if constexpr (std::is_same_v<Container, RelationVector<Relation>>) {
+        interleaveOverNodes(data.data(), data.size() * sizeof(Relation));
+      } else if constexpr (requires { Container::forEachColumn(data, [](const auto&) {}); }) {
+        Container::forEachColumn(data, [](const auto& column) { interleaveOverNodes(column.data(), column.size() * sizeof(column[0])); });
       }
+    }
 
-      return true;
+    // Line without its trailing "\n" or "\r\n"
+    inline std::string_view trimLine(std::string_view line) {
+      if (!line.empty() && line.back() == '\n') {
+        line.remove_suffix(1);
+      }
+      if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+      }
+      return line;
     }
 
-    template <typename Relation>
-    std::vector<Relation> load(const std::string& filename, const size_t numberOfTuples = SIZE_MAX) {
-      std::vector<Relation> data;
-      std::ifstream file(filename);
-      if (!file.is_open()) {
-        std::cerr << "Error: Failed to open file " << filename << std::endl;
-        exit(-1);
+    // Outcome of parsing one CSV line
+    enum class LineStatus {
+      Accepted,
+      // Well-formed, but filtered out by a pushed down predicate (Pushdown.hpp)
+      Rejected,
+      Invalid,
+    };
+
+    // Lines parsed per batch when invalid or rejected lines leave a limited load short of its tuples
+    static constexpr size_t LOAD_TOP_UP_LINES = 64 * 1024;
+
+    // Parses up to lineLimit lines of [begin, end) in parallel and appends the accepted rows to the
+    // first loaded rows of data, in file order. The byte range is split into ranges that are
+    // realigned to the next line start; every range counts its lines, a prefix sum gives each range
+    // its first row index, and then all ranges parse their lines straight into their rows of the
+    // preallocated storage. Returns the number of rows kept in data and the start of the first
+    // line behind the parsed ones.
+    template <typename Relation, typename Container, typename ParseRow>
+    std::pair<size_t, const char*> parseLineBatch(const char* const begin, const char* const end, const size_t lineLimit, Container& data, const size_t loaded,
+                                                  ParseRow& parseRow, const int numThreads) {
+      // Line aligned byte ranges, a few per thread so that dynamic scheduling can balance them
+      const size_t numberOfRanges = std::max<size_t>(std::min<size_t>(static_cast<size_t>(std::max(numThreads, 1)) * 4, (end - begin) / 4096), 1);
+      std::vector<const char*> rangeBegin(numberOfRanges + 1, end);
+      rangeBegin[0] = begin;
+      for (size_t range = 1; range < numberOfRanges; ++range) {
+        const char* raw = begin + range * static_cast<size_t>(end - begin) / numberOfRanges;
+        rangeBegin[range] = std::max(nextLine(raw - 1, end), rangeBegin[range - 1]);
       }
 
-      std::string line;
-      bool firstLine = true;
-      while (std::getline(file, line)) {
-        if (firstLine) {
-          firstLine = false;
-          continue;
+      // Ranges are counted in order, a group of numThreads ranges at a time, until they cover
+      // lineLimit lines; no range counts more lines than are still missing. Without a limit all
+      // ranges form one group.
+      std::vector<size_t> rangeRow(numberOfRanges + 1, 0);
+      const size_t groupSize = lineLimit == SIZE_MAX ? numberOfRanges : static_cast<size_t>(std::max(numThreads, 1));
+      size_t countedRanges = 0;
+      while (countedRanges < numberOfRanges && rangeRow[countedRanges] < lineLimit) {
+        const size_t groupBegin = countedRanges;
+        const size_t groupEnd = std::min(groupBegin + groupSize, numberOfRanges);
+        const size_t missing = lineLimit - rangeRow[groupBegin];
+#pragma omp parallel for schedule(dynamic) num_threads(numThreads)
+        for (size_t range = groupBegin; range < groupEnd; ++range) {
+          rangeRow[range + 1] = countLines(rangeBegin[range], rangeBegin[range + 1], missing);
         }
-        Relation record;
-        if (parseLine(line, record)) {
-          data.emplace_back(record);
-        } else {
-          std::cerr << "Error: Failed to parse line: " << line << std::endl;
+        for (size_t range = groupBegin; range < groupEnd; ++range) {
+          rangeRow[range + 1] += rangeRow[range];
         }
+        countedRanges = groupEnd;
+      }
 
-        if (data.size() >= numberOfTuples) {
-          std::cout << "Loaded enough tuples. Returning now..." << std::endl;
-          break;
+      // Only the first lineLimit lines are parsed; lines that fail to parse or are rejected are marked invalid
+      const size_t parsedLines = std::min(rangeRow[countedRanges], lineLimit);
+      if (parsedLines == 0) {
+        return {loaded, end};
+      }
+      data.resize(loaded + parsedLines);
+      interleaveRows<Relation>(data);
+      std::vector<char> valid(parsedLines, 0);
+      // Start of the first line behind the parsed ones
+      const char* parsedEnd = end;
+
+#pragma omp parallel for schedule(dynamic) num_threads(numThreads)
+      for (size_t range = 0; range < countedRanges; ++range) {
+        const char* position = rangeBegin[range];
+        for (size_t row = rangeRow[range]; row < std::min(rangeRow[range + 1], parsedLines); ++row) {
+          const char* lineEnd = nextLine(position, end);
+          const std::string_view line = trimLine(std::string_view(position, lineEnd - position));
+          position = lineEnd;
+          if (row + 1 == parsedLines) {
+            parsedEnd = lineEnd;
+          }
+
+          const LineStatus status = parseRow(line, data, loaded + row);
+          valid[row] = status == LineStatus::Accepted;
+          if (status == LineStatus::Invalid) {
+            std::cerr << "Error: Failed to parse line: " << line << std::endl;
+          }
         }
       }
 
-      file.close();
+      // Close the gaps of invalid and rejected lines; this is a no-op for well-formed files without predicates
+      size_t kept = loaded;
+      for (size_t row = 0; row < parsedLines; ++row) {
+        if (valid[row]) {
+          if (kept != loaded + row) {
+            moveRow<Relation>(data, kept, loaded + row);
+          }
+          kept++;
+        }
+      }
+      return {kept, parsedEnd};
+    }
+
+    // Loads a CSV file with a header line in parallel (see parseLineBatch); rows keep the order of
+    // the file. parseRow(line, data, index) parses a line into row index of data and returns its
+    // LineStatus; only accepted rows are kept and count towards numberOfTuples. Invalid and
+    // rejected lines do not count, so a limited load that comes up short parses the lines behind
+    // the limit in further parallel batches.
+    template <typename Relation, typename Container, typename ParseRow>
+    Container loadLines(const std::string& filename, ParseRow&& parseRow, const size_t numberOfTuples, const int numThreads) {
+      Container data;
+      const MappedFile file(filename);
+      if (!file.isOpen()) {
+        std::cerr << "Error: Failed to open file " << filename << std::endl;
+        exit(-1);
+      }
+
+      const char* const end = file.data() + file.size();
+      // Skip the header line
+      const char* position = file.size() > 0 ? nextLine(file.data(), end) : end;
+
+      size_t loaded = 0;
+      bool firstBatch = true;
+      while (position < end && loaded < numberOfTuples) {
+        const size_t missing = numberOfTuples - loaded;
+        const size_t lineLimit = firstBatch ? missing : std::max(missing, LOAD_TOP_UP_LINES);
+        std::tie(loaded, position) = parseLineBatch<Relation>(position, end, lineLimit, data, loaded, parseRow, numThreads);
+        firstBatch = false;
+      }
+
+      // A top-up batch may accept more lines than were missing
+      loaded = std::min(loaded, numberOfTuples);
+      data.resize(loaded);
+      if (loaded >= numberOfTuples) {
+        std::cout << "Loaded enough tuples. Returning now..." << std::endl;
+      }
       std::cout << "Loaded " << data.size() << " tuples from file." << std::endl;
       return data;
     }
 
-    inline std::vector<TitleRelation> loadTitleRelation(const std::string& filename, const size_t numberOfTuples = SIZE_MAX) {
-      return load<TitleRelation>(filename, numberOfTuples);
+    // Container is RelationVector<Relation> or any type providing resize, size, operator[] and set(index, row).
+    template <typename Relation, typename Container = RelationVector<Relation>>
+    Container load(const std::string& filename, const size_t numberOfTuples = SIZE_MAX, const int numThreads = defaultLoadThreads()) {
+      return loadLines<Relation, Container>(filename, [](std::string_view line, Container& data, const size_t index) {
+        return parseLineInto<Relation>(line, data, index) ? LineStatus::Accepted : LineStatus::Invalid;
+      }, numberOfTuples, numThreads);
     }
 
-    inline std::vector<CastRelation> loadCastRelation(const std::string& filename, const size_t numberOfTuples = SIZE_MAX) {
-      return load<CastRelation>(filename, numberOfTuples);
+    inline RelationVector<TitleRelation> loadTitleRelation(const std::string& filename, const size_t numberOfTuples = SIZE_MAX, const int numThreads = defaultLoadThreads()) {
+      return load<TitleRelation>(filename, numberOfTuples, numThreads);
     }
 
+    inline RelationVector<CastRelation> loadCastRelation(const std::string& filename, const size_t numberOfTuples = SIZE_MAX, const int numThreads = defaultLoadThreads()) {
+      return load<CastRelation>(filename, numberOfTuples, numThreads);
+    }
+
+    // Initial read buffer of CsvBatchReader; it grows if a single line does not fit
+    static constexpr size_t CSV_READ_BUFFER_SIZE = 4 * 1024 * 1024;
+
+    // Reads a CSV file with a header line batch by batch through a fixed size buffer, so files
+    // larger than memory can be streamed. operator() matches the CastBatchReader/TitleBatchReader
+    // signature of the streaming join; pass the reader as std::ref(reader).
+    template <typename Relation>
+    class CsvBatchReader {
+     public:
+      explicit CsvBatchReader(const std::string& filename, const size_t bufferSize = CSV_READ_BUFFER_SIZE)
+          : buffer(std::max<size_t>(bufferSize, 1)) {
+        fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+          std::cerr << "Error: Failed to open file " << filename << std::endl;
+          exit(-1);
+        }
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+      }
+
+      ~CsvBatchReader() {
+        close(fd);
+      }
+
+      CsvBatchReader(const CsvBatchReader&) = delete;
+      CsvBatchReader& operator=(const CsvBatchReader&) = delete;
+
+      // Appends up to maxTuples parsed tuples to batch; returns how many were appended (0 at the end)
+      size_t operator()(RelationVector<Relation>& batch, const size_t maxTuples) {
+        size_t appended = 0;
+        std::string_view line;
+        while (appended < maxTuples && readLine(line)) {
+          line = trimLine(line);
+          Relation record;
+          if (parseLine(line, record)) {
+            batch.push_back(record);
+            appended++;
+          } else {
+            std::cerr << "Error: Failed to parse line: " << line << std::endl;
+          }
+        }
+        return appended;
+      }
+
+     private:
+      // Next line of the file without the header; the view stays valid until the next call
+      bool readLine(std::string_view& line) {
+        while (true) {
+          const auto* newline = static_cast<const char*>(std::memchr(buffer.data() + begin, '\n', end - begin));
+          if (newline != nullptr || (endOfFile && begin < end)) {
+            const size_t lineEnd = newline != nullptr ? static_cast<size_t>(newline - buffer.data()) + 1 : end;
+            line = std::string_view(buffer.data() + begin, lineEnd - begin);
+            begin = lineEnd;
+            if (!headerSkipped) {
+              headerSkipped = true;
+              continue;
+            }
+            return true;
+          }
+          if (endOfFile) {
+            return false;
+          }
+
+          // Move the partial line to the front and fill the rest of the buffer with one large read
+          std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+          end -= begin;
+          begin = 0;
+          if (end == buffer.size()) {
+            buffer.resize(buffer.size() * 2);
+          }
+          const ssize_t bytes = read(fd, buffer.data() + end, buffer.size() - end);
+          if (bytes <= 0) {
+            endOfFile = true;
+          } else {
+            end += static_cast<size_t>(bytes);
+          }
+        }
+      }
+
+      int fd = -1;
+      std::vector<char> buffer;
+      size_t begin = 0;
+      size_t end = 0;
+      bool endOfFile = false;
+      bool headerSkipped = false;
+    };
+
     inline ResultRelation createResultTuple(const CastRelation& cast, const TitleRelation& title) {
       ResultRelation result;
       // Assign values from title to result
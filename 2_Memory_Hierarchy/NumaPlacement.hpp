@@ -0,0 +1,151 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef NUMAPLACEMENT_HPP
+#define NUMAPLACEMENT_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+//==--------------------------------------------------------------------==//
+//==----------------------- NUMA PLACEMENT -----------------------------==//
+//==--------------------------------------------------------------------==//
+
+// The topology comes from sysfs and memory is placed with the raw mbind system call, so there is
+// no libnuma dependency. On single-node machines (or when sysfs or mbind are unavailable) every
+// helper turns into a no-op and the join runs exactly as without NUMA awareness.
+
+// Memory policy constants of <numaif.h>
+static constexpr int NUMA_MPOL_BIND = 2;
+static constexpr int NUMA_MPOL_INTERLEAVE = 3;
+static constexpr unsigned NUMA_MPOL_MF_MOVE = 1u << 1;
+static constexpr size_t NUMA_MAX_NODES = 64;
+
+struct NumaTopology {
+    // CPUs of every node; a machine without NUMA information is one node with all CPUs
+    std::vector<std::vector<int>> nodeCpus;
+
+    [[nodiscard]] int numNodes() const { return static_cast<int>(nodeCpus.size()); }
+    [[nodiscard]] bool isNuma() const { return nodeCpus.size() > 1; }
+};
+
+// Parses a sysfs cpulist such as "0-3,8,10-11"
+inline std::vector<int> parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        if (range.empty() || range == "\n") {
+            continue;
+        }
+        const size_t dash = range.find('-');
+        const int first = std::stoi(range.substr(0, dash));
+        const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+inline NumaTopology detectNumaTopology() {
+    NumaTopology topology;
+    for (size_t node = 0; node < NUMA_MAX_NODES; ++node) {
+        std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        if (!file) {
+            break;
+        }
+        std::string list;
+        std::getline(file, list);
+        std::vector<int> cpus = parseCpuList(list);
+        if (cpus.empty()) {
+            // Memory-only node; threads are never placed there
+            break;
+        }
+        topology.nodeCpus.push_back(std::move(cpus));
+    }
+    if (topology.nodeCpus.empty()) {
+        std::vector<int> cpus(std::max(std::thread::hardware_concurrency(), 1u));
+        for (size_t cpu = 0; cpu < cpus.size(); ++cpu) {
+            cpus[cpu] = static_cast<int>(cpu);
+        }
+        topology.nodeCpus.push_back(std::move(cpus));
+    }
+    return topology;
+}
+
+// Topology of this machine, read once
+inline const NumaTopology& numaTopology() {
+    static const NumaTopology topology = detectNumaTopology();
+    return topology;
+}
+
+// Node of a worker thread: threads are spread over the nodes in contiguous blocks
+inline int numaNodeOfThread(int thread, int numThreads, const NumaTopology& topology = numaTopology()) {
+    return static_cast<int>(static_cast<int64_t>(thread) * topology.numNodes() / std::max(numThreads, 1));
+}
+
+// Pins the calling thread to one CPU of the node its thread number maps to
+inline bool pinThreadToNode(int thread, int numThreads, const NumaTopology& topology = numaTopology()) {
+    const int node = numaNodeOfThread(thread, numThreads, topology);
+    const std::vector<int>& cpus = topology.nodeCpus[node];
+    const int threads_on_node_before = thread - static_cast<int>((static_cast<int64_t>(node) * numThreads + topology.numNodes() - 1) / topology.numNodes());
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpus[std::max(threads_on_node_before, 0) % cpus.size()], &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+// Applies a memory policy to the whole pages inside [data, data + bytes) and migrates pages that
+// are already touched. Partial pages at the ends are left alone, since they are shared with the
+// neighbouring ranges.
+inline bool applyMemoryPolicy(const void* data, size_t bytes, int mode, uint64_t nodeMask) {
+    const auto page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const auto begin = (reinterpret_cast<uintptr_t>(data) + page_size - 1) / page_size * page_size;
+    const auto end = (reinterpret_cast<uintptr_t>(data) + bytes) / page_size * page_size;
+    if (end <= begin) {
+        return false;
+    }
+#ifdef SYS_mbind
+    return syscall(SYS_mbind, begin, end - begin, mode, &nodeMask, NUMA_MAX_NODES + 1, NUMA_MPOL_MF_MOVE) == 0;
+#else
+    return false;
+#endif
+}
+
+// Moves the pages of a range to one node; does nothing on single-node machines
+inline bool placeOnNode(const void* data, size_t bytes, int node, const NumaTopology& topology = numaTopology()) {
+    if (!topology.isNuma()) {
+        return false;
+    }
+    return applyMemoryPolicy(data, bytes, NUMA_MPOL_BIND, uint64_t{1} << node);
+}
+
+// Spreads the pages of a range round robin over all nodes
+inline bool interleaveOverNodes(const void* data, size_t bytes, const NumaTopology& topology = numaTopology()) {
+    if (!topology.isNuma()) {
+        return false;
+    }
+    return applyMemoryPolicy(data, bytes, NUMA_MPOL_INTERLEAVE, (uint64_t{1} << topology.numNodes()) - 1);
+}
+
+#endif // NUMAPLACEMENT_HPP
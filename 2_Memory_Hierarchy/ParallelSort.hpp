@@ -0,0 +1,126 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef PARALLELSORT_HPP
+#define PARALLELSORT_HPP
+
+#include "RadixHashJoin.hpp"
+#include <omp.h>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+//==--------------------------------------------------------------------==//
+//==---------------------- PARALLEL SORT STAGE -------------------------==//
+//==--------------------------------------------------------------------==//
+
+static constexpr unsigned SORT_RADIX_BITS = 8;
+static constexpr size_t SORT_RADIX_FANOUT = size_t{1} << SORT_RADIX_BITS;
+
+// Checks in one parallel pass whether keys are sorted ascending
+template <typename Keys>
+bool isSortedParallel(const Keys& keys, int numThreads) {
+    const size_t size = keys.size();
+    const int num_chunks = std::max(numThreads, 1);
+    bool sorted = true;
+
+#pragma omp parallel for schedule(static) num_threads(numThreads) shared(keys) reduction(&& : sorted)
+    for (int chunk = 0; chunk < num_chunks; ++chunk) {
+        // Every chunk also compares its first key with the last key of the previous chunk
+        const size_t begin = std::max<size_t>(chunk * size / num_chunks, 1);
+        const size_t end = (chunk + 1) * size / num_chunks;
+        for (size_t i = begin; i < end; ++i) {
+            sorted = sorted && keys[i - 1] <= keys[i];
+        }
+    }
+    return sorted;
+}
+
+// Radix digit of a signed key; flipping the sign bit makes the unsigned order match the signed one
+inline uint32_t sortDigit(int32_t key, unsigned shift) {
+    return ((static_cast<uint32_t>(key) ^ 0x80000000u) >> shift) & (SORT_RADIX_FANOUT - 1);
+}
+
+// Sorts the (key, row id) pairs of a relation with a parallel LSD radix sort instead of moving
+// the fat tuples. Every pass builds per-chunk histograms, turns them into stable per-chunk write
+// cursors and scatters the chunks in parallel. Passes whose digit is equal for all keys are skipped,
+// so dense key ranges usually need only two or three passes.
+template <typename Keys>
+std::vector<RadixTuple> parallelRadixSort(const Keys& keys, int numThreads) {
+    const size_t size = keys.size();
+    const int num_chunks = std::max(numThreads, 1);
+    std::vector<RadixTuple> data(size);
+    std::vector<RadixTuple> buffer(size);
+
+#pragma omp parallel for schedule(static) num_threads(numThreads) shared(keys, data)
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = {keys[i], static_cast<uint32_t>(i)};
+    }
+
+    std::vector<size_t> histograms(num_chunks * SORT_RADIX_FANOUT);
+    for (unsigned shift = 0; shift < 32; shift += SORT_RADIX_BITS) {
+        std::fill(histograms.begin(), histograms.end(), 0);
+
+#pragma omp parallel for schedule(static) num_threads(numThreads) shared(data, histograms)
+        for (int chunk = 0; chunk < num_chunks; ++chunk) {
+            size_t* histogram = histograms.data() + chunk * SORT_RADIX_FANOUT;
+            for (size_t i = chunk * size / num_chunks; i < (chunk + 1) * size / num_chunks; ++i) {
+                histogram[sortDigit(data[i].key, shift)]++;
+            }
+        }
+
+        // Digit-major, chunk-minor prefix sum keeps the sort stable
+        size_t offset = 0;
+        bool single_digit = false;
+        for (size_t digit = 0; digit < SORT_RADIX_FANOUT; ++digit) {
+            const size_t digit_begin = offset;
+            for (int chunk = 0; chunk < num_chunks; ++chunk) {
+                const size_t count = histograms[chunk * SORT_RADIX_FANOUT + digit];
+                histograms[chunk * SORT_RADIX_FANOUT + digit] = offset;
+                offset += count;
+            }
+            single_digit = single_digit || offset - digit_begin == size;
+        }
+        if (single_digit) {
+            continue;
+        }
+
+#pragma omp parallel for schedule(static) num_threads(numThreads) shared(data, buffer, histograms)
+        for (int chunk = 0; chunk < num_chunks; ++chunk) {
+            size_t* cursor = histograms.data() + chunk * SORT_RADIX_FANOUT;
+            for (size_t i = chunk * size / num_chunks; i < (chunk + 1) * size / num_chunks; ++i) {
+                buffer[cursor[sortDigit(data[i].key, shift)]++] = data[i];
+            }
+        }
+        data.swap(buffer);
+    }
+
+    return data;
+}
+
+// (key, row id) pairs of a relation in key order; already sorted keys are only copied
+template <typename Keys>
+std::vector<RadixTuple> sortKeyRows(const Keys& keys, bool alreadySorted, int numThreads) {
+    if (!alreadySorted) {
+        return parallelRadixSort(keys, numThreads);
+    }
+    std::vector<RadixTuple> data(keys.size());
+#pragma omp parallel for schedule(static) num_threads(numThreads) shared(keys, data)
+    for (size_t i = 0; i < keys.size(); ++i) {
+        data[i] = {keys[i], static_cast<uint32_t>(i)};
+    }
+    return data;
+}
+
+#endif // PARALLELSORT_HPP
@@ -0,0 +1,262 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef PERFCOUNTERS_HPP
+#define PERFCOUNTERS_HPP
+
+#include "TimerUtil.hpp"
+#include <omp.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+//==--------------------------------------------------------------------==//
+//==-------------------- HARDWARE PERFORMANCE COUNTERS -----------------==//
+//==--------------------------------------------------------------------==//
+
+enum class PerfEvent : size_t {
+    // CPU time of the thread in nanoseconds (software event, always available)
+    TaskClock,
+    Cycles,
+    Instructions,
+    LlcMisses,
+    DtlbMisses,
+    BranchMisses,
+};
+static constexpr size_t NUM_PERF_EVENTS = 6;
+
+inline const char* perfEventName(PerfEvent event) {
+    switch (event) {
+    case PerfEvent::TaskClock: return "task-clock";
+    case PerfEvent::Cycles: return "cycles";
+    case PerfEvent::Instructions: return "instructions";
+    case PerfEvent::LlcMisses: return "LLC-misses";
+    case PerfEvent::DtlbMisses: return "dTLB-misses";
+    case PerfEvent::BranchMisses: return "branch-misses";
+    }
+    return "unknown";
+}
+
+inline perf_event_attr perfEventAttributes(PerfEvent event) {
+    perf_event_attr attributes{};
+    attributes.size = sizeof(attributes);
+    attributes.type = PERF_TYPE_HARDWARE;
+    switch (event) {
+    case PerfEvent::TaskClock:
+        attributes.type = PERF_TYPE_SOFTWARE;
+        attributes.config = PERF_COUNT_SW_TASK_CLOCK;
+        break;
+    case PerfEvent::Cycles: attributes.config = PERF_COUNT_HW_CPU_CYCLES; break;
+    case PerfEvent::Instructions: attributes.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+    case PerfEvent::LlcMisses:
+        attributes.type = PERF_TYPE_HW_CACHE;
+        attributes.config = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+    case PerfEvent::DtlbMisses:
+        attributes.type = PERF_TYPE_HW_CACHE;
+        attributes.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+    case PerfEvent::BranchMisses: attributes.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+    }
+    // User space only, which is allowed up to perf_event_paranoid 2
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return attributes;
+}
+
+// Counter values; an event the kernel or the CPU does not provide stays invalid
+struct PerfCounts {
+    std::array<uint64_t, NUM_PERF_EVENTS> values{};
+    std::array<bool, NUM_PERF_EVENTS> valid{};
+
+    [[nodiscard]] uint64_t operator[](PerfEvent event) const { return values[static_cast<size_t>(event)]; }
+    [[nodiscard]] bool has(PerfEvent event) const { return valid[static_cast<size_t>(event)]; }
+
+    PerfCounts& operator+=(const PerfCounts& other) {
+        for (size_t i = 0; i < NUM_PERF_EVENTS; ++i) {
+            values[i] += other.values[i];
+            valid[i] = valid[i] || other.valid[i];
+        }
+        return *this;
+    }
+
+    // Counts between two readings of the same counters
+    [[nodiscard]] PerfCounts operator-(const PerfCounts& start) const {
+        PerfCounts delta;
+        for (size_t i = 0; i < NUM_PERF_EVENTS; ++i) {
+            delta.valid[i] = valid[i] && start.valid[i];
+            delta.values[i] = delta.valid[i] && values[i] > start.values[i] ? values[i] - start.values[i] : 0;
+        }
+        return delta;
+    }
+
+    // Valid counters as Timer metrics, plus instructions per cycle and misses per 1000 instructions
+    [[nodiscard]] std::vector<Timer<>::Metric> metrics() const {
+        std::vector<Timer<>::Metric> result;
+        for (size_t i = 1; i < NUM_PERF_EVENTS; ++i) {
+            if (valid[i]) {
+                result.emplace_back(perfEventName(static_cast<PerfEvent>(i)), static_cast<double>(values[i]));
+            }
+        }
+        const auto instructions = static_cast<double>((*this)[PerfEvent::Instructions]);
+        if (has(PerfEvent::Cycles) && has(PerfEvent::Instructions) && (*this)[PerfEvent::Cycles] > 0) {
+            result.emplace_back("IPC", instructions / static_cast<double>((*this)[PerfEvent::Cycles]));
+        }
+        if (has(PerfEvent::Instructions) && instructions > 0) {
+            for (const PerfEvent event : {PerfEvent::LlcMisses, PerfEvent::BranchMisses}) {
+                if (has(event)) {
+                    result.emplace_back(std::string(perfEventName(event)) + "-PKI", 1000.0 * static_cast<double>((*this)[event]) / instructions);
+                }
+            }
+        }
+        return result;
+    }
+};
+
+// Counters of the calling thread, opened with perf_event_open. Events that cannot be opened
+// (no PMU in a VM, perf_event_paranoid too strict) are skipped. Multiplexed counters are scaled
+// up to the time they were enabled.
+class PerfCounters {
+  public:
+    PerfCounters() {
+        for (size_t i = 0; i < NUM_PERF_EVENTS; ++i) {
+            perf_event_attr attributes = perfEventAttributes(static_cast<PerfEvent>(i));
+            fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+        }
+    }
+
+    ~PerfCounters() {
+        for (const int fd : fds) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    [[nodiscard]] bool isOpen(PerfEvent event) const { return fds[static_cast<size_t>(event)] >= 0; }
+
+    [[nodiscard]] PerfCounts read() const {
+        PerfCounts counts;
+        for (size_t i = 0; i < NUM_PERF_EVENTS; ++i) {
+            uint64_t buffer[3];
+            if (fds[i] < 0 || ::read(fds[i], buffer, sizeof(buffer)) != sizeof(buffer) || buffer[2] == 0) {
+                continue;
+            }
+            const double scale = static_cast<double>(buffer[1]) / static_cast<double>(buffer[2]);
+            counts.values[i] = static_cast<uint64_t>(static_cast<double>(buffer[0]) * scale);
+            counts.valid[i] = true;
+        }
+        return counts;
+    }
+
+  private:
+    std::array<int, NUM_PERF_EVENTS> fds{};
+};
+
+//==--------------------------------------------------------------------==//
+//==-------------------------- JOIN PROFILE ----------------------------==//
+//==--------------------------------------------------------------------==//
+
+struct PhaseProfile {
+    std::string name;
+    std::chrono::nanoseconds wallTime{0};
+    // Counts of every OpenMP thread during the phase
+    std::vector<PerfCounts> threads;
+
+    [[nodiscard]] PerfCounts total() const {
+        PerfCounts sum;
+        for (const PerfCounts& counts : threads) {
+            sum += counts;
+        }
+        return sum;
+    }
+};
+
+// Wall time and per-thread counters of the join phases. beginPhase and endPhase read the counters
+// of every thread of an OpenMP team of the phase's size; OpenMP reuses its pooled threads for
+// teams of the same size, so the same OS threads run the phase in between.
+class JoinProfile {
+  public:
+    void beginPhase(std::string name, int numThreads) {
+        numThreads = std::max(numThreads, 1);
+        if (counters.size() < static_cast<size_t>(numThreads)) {
+            counters.resize(numThreads);
+        }
+        PhaseProfile& phase = phaseList.emplace_back();
+        phase.name = std::move(name);
+        phase.threads.resize(numThreads);
+        threadStart.assign(numThreads, {});
+
+#pragma omp parallel num_threads(numThreads)
+        {
+            const int thread = omp_get_thread_num();
+            if (!counters[thread]) {
+                counters[thread] = std::make_unique<PerfCounters>();
+            }
+            threadStart[thread] = counters[thread]->read();
+        }
+        timer.start();
+    }
+
+    void endPhase() {
+        PhaseProfile& phase = phaseList.back();
+        const auto numThreads = static_cast<int>(phase.threads.size());
+
+#pragma omp parallel num_threads(numThreads)
+        {
+            const int thread = omp_get_thread_num();
+            phase.threads[thread] = counters[thread]->read() - threadStart[thread];
+        }
+
+        std::vector<Timer<>::Snapshot> children;
+        for (size_t thread = 0; thread < phase.threads.size(); ++thread) {
+            const PerfCounts& counts = phase.threads[thread];
+            children.emplace_back(timer.createFullyQualifiedSnapShotName(phase.name + "_thread_" + std::to_string(thread)),
+                                  std::chrono::nanoseconds(counts[PerfEvent::TaskClock]), std::vector<Timer<>::Snapshot>(), counts.metrics());
+        }
+        timer.snapshot(phase.name, phase.total().metrics(), std::move(children));
+        timer.pause();
+        phase.wallTime = timer.getSnapshots().back().runtime;
+    }
+
+    [[nodiscard]] const std::vector<PhaseProfile>& phases() const { return phaseList; }
+
+    // One snapshot per phase with the summed counters; below it one snapshot per thread with its
+    // CPU time and counters
+    [[nodiscard]] const Timer<>& report() const { return timer; }
+
+    [[nodiscard]] bool hardwareCountersAvailable() const {
+        return !counters.empty() && counters[0] && counters[0]->isOpen(PerfEvent::Cycles);
+    }
+
+  private:
+    std::vector<PhaseProfile> phaseList;
+    std::vector<std::unique_ptr<PerfCounters>> counters;
+    std::vector<PerfCounts> threadStart;
+    Timer<> timer{"join"};
+};
+
+#endif // PERFCOUNTERS_HPP
@@ -0,0 +1,291 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef PUSHDOWN_HPP
+#define PUSHDOWN_HPP
+
+#include "JoinUtils.hpp"
+#include "ColumnarRelation.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <iostream>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//==--------------------------------------------------------------------==//
+//==------------------- PREDICATE & PROJECTION PUSHDOWN ----------------==//
+//==--------------------------------------------------------------------==//
+
+// Fields in CSV order, which is also the member order of the relation and its columns
+enum class CastField : size_t { CastInfoId, PersonId, MovieId, PersonRoleId, Note, NrOrder, RoleId };
+enum class TitleField : size_t { TitleId, Title, ImdbIndex, KindId, ProductionYear, ImdbId, PhoneticCode, EpisodeOfId, SeasonNr, EpisodeNr, SeriesYears, Md5sum };
+
+// Row members and the matching columns of the columnar relation, indexed by field
+template <typename Relation>
+struct RelationSchema;
+
+template <>
+struct RelationSchema<CastRelation> {
+    using Field = CastField;
+    using Columns = CastColumns;
+    static constexpr size_t numFields = NUM_FIELD_CAST_RELATION;
+    static constexpr auto members = std::make_tuple(&CastRelation::castInfoId, &CastRelation::personId, &CastRelation::movieId, &CastRelation::personRoleId,
+                                                    &CastRelation::note, &CastRelation::nrOrder, &CastRelation::roleId);
+    static constexpr auto columns = std::make_tuple(&CastColumns::castInfoId, &CastColumns::personId, &CastColumns::movieId, &CastColumns::personRoleId,
+                                                    &CastColumns::note, &CastColumns::nrOrder, &CastColumns::roleId);
+};
+
+template <>
+struct RelationSchema<TitleRelation> {
+    using Field = TitleField;
+    using Columns = TitleColumns;
+    static constexpr size_t numFields = NUM_FIELDS_TITLE_RELATION;
+    static constexpr auto members = std::make_tuple(&TitleRelation::titleId, &TitleRelation::title, &TitleRelation::imdbIndex, &TitleRelation::kindId,
+                                                    &TitleRelation::productionYear, &TitleRelation::imdbId, &TitleRelation::phoneticCode, &TitleRelation::episodeOfId,
+                                                    &TitleRelation::seasonNr, &TitleRelation::episodeNr, &TitleRelation::seriesYears, &TitleRelation::md5sum);
+    static constexpr auto columns = std::make_tuple(&TitleColumns::titleId, &TitleColumns::title, &TitleColumns::imdbIndex, &TitleColumns::kindId,
+                                                    &TitleColumns::productionYear, &TitleColumns::imdbId, &TitleColumns::phoneticCode, &TitleColumns::episodeOfId,
+                                                    &TitleColumns::seasonNr, &TitleColumns::episodeNr, &TitleColumns::seriesYears, &TitleColumns::md5sum);
+};
+
+// Calls visit(field, member, column) for every field of Relation, with the field index and the
+// pointers to its row member and to its column
+template <typename Relation, typename Visit>
+void forEachField(Visit&& visit) {
+    using Schema = RelationSchema<Relation>;
+    [&]<size_t... Field>(std::index_sequence<Field...>) {
+        (visit(Field, std::get<Field>(Schema::members), std::get<Field>(Schema::columns)), ...);
+    }(std::make_index_sequence<Schema::numFields>{});
+}
+
+// Pointer to an int32_t field of Relation; nullptr for string fields
+template <typename Relation>
+int32_t Relation::*integerMember(size_t field) {
+    int32_t Relation::*result = nullptr;
+    forEachField<Relation>([&](size_t index, auto member, auto) {
+        if constexpr (std::is_same_v<decltype(member), int32_t Relation::*>) {
+            if (index == field) {
+                result = member;
+            }
+        }
+    });
+    return result;
+}
+
+template <typename Field>
+class FieldSet {
+  public:
+    FieldSet() = default;
+    FieldSet(std::initializer_list<Field> fields) {
+        for (const Field field : fields) {
+            insert(field);
+        }
+    }
+
+    [[nodiscard]] static FieldSet all() {
+        FieldSet set;
+        set.bits = UINT32_MAX;
+        return set;
+    }
+
+    void insert(Field field) { bits |= uint32_t{1} << static_cast<size_t>(field); }
+    [[nodiscard]] bool contains(Field field) const { return contains(static_cast<size_t>(field)); }
+    [[nodiscard]] bool contains(size_t field) const { return (bits >> field) & 1u; }
+
+  private:
+    uint32_t bits = 0;
+};
+
+enum class Compare { Equal, NotEqual, Less, LessEqual, Greater, GreaterEqual };
+
+// Comparison of an integer field with a constant, e.g. {TitleField::ProductionYear, Compare::Greater, 2000}
+template <typename Field>
+struct FieldPredicate {
+    Field field;
+    Compare compare;
+    int32_t value;
+
+    [[nodiscard]] bool matches(int32_t fieldValue) const {
+        switch (compare) {
+        case Compare::Equal: return fieldValue == value;
+        case Compare::NotEqual: return fieldValue != value;
+        case Compare::Less: return fieldValue < value;
+        case Compare::LessEqual: return fieldValue <= value;
+        case Compare::Greater: return fieldValue > value;
+        case Compare::GreaterEqual: return fieldValue >= value;
+        }
+        return false;
+    }
+};
+
+using CastPredicate = FieldPredicate<CastField>;
+using TitlePredicate = FieldPredicate<TitleField>;
+
+template <typename Relation>
+using RelationPredicate = FieldPredicate<typename RelationSchema<Relation>::Field>;
+
+// Predicates are only supported on integer fields
+template <typename Relation>
+bool validPredicates(const std::vector<RelationPredicate<Relation>>& predicates) {
+    for (const auto& predicate : predicates) {
+        if (integerMember<Relation>(static_cast<size_t>(predicate.field)) == nullptr) {
+            std::cerr << "Error: Predicate on non-integer field " << static_cast<size_t>(predicate.field) << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Predicate bound to its row member, for evaluating it on loaded tuples
+template <typename Relation>
+struct BoundPredicate {
+    int32_t Relation::*member;
+    RelationPredicate<Relation> predicate;
+
+    [[nodiscard]] bool operator()(const Relation& record) const { return predicate.matches(record.*member); }
+};
+
+template <typename Relation>
+std::vector<BoundPredicate<Relation>> bindPredicates(const std::vector<RelationPredicate<Relation>>& predicates) {
+    std::vector<BoundPredicate<Relation>> bound;
+    for (const auto& predicate : predicates) {
+        bound.push_back({integerMember<Relation>(static_cast<size_t>(predicate.field)), predicate});
+    }
+    return bound;
+}
+
+template <typename Relation>
+bool matchesAll(const std::vector<BoundPredicate<Relation>>& predicates, const Relation& record) {
+    return std::ranges::all_of(predicates, [&](const BoundPredicate<Relation>& predicate) { return predicate(record); });
+}
+
+//==--------------------------------------------------------------------==//
+//==---------------------------- SCAN ----------------------------------==//
+//==--------------------------------------------------------------------==//
+
+// Which tuples and fields a scan loads
+template <typename Relation>
+struct ScanSpec {
+    using Field = typename RelationSchema<Relation>::Field;
+    // All of them have to hold for a tuple to be loaded
+    std::vector<FieldPredicate<Field>> predicates;
+    // Fields that are parsed into the loaded tuples; the others stay zero
+    FieldSet<Field> projection = FieldSet<Field>::all();
+};
+
+// Splits the line into its fields, evaluates the predicates on the raw fields and only then
+// parses the projected fields, so a rejected line never copies a string. Invalid lines are
+// reported by the loader.
+template <typename Relation>
+LineStatus parseProjectedLine(std::string_view line, Relation& record, const ScanSpec<Relation>& spec) {
+    constexpr size_t numFields = RelationSchema<Relation>::numFields;
+    std::array<std::string_view, numFields> fields;
+    size_t fieldIndex = 0;
+    while (true) {
+        const auto* delimiter = static_cast<const char*>(std::memchr(line.data(), ',', line.size()));
+        const size_t length = delimiter != nullptr ? static_cast<size_t>(delimiter - line.data()) : line.size();
+        if (fieldIndex >= numFields) {
+            return LineStatus::Invalid;
+        }
+        fields[fieldIndex++] = line.substr(0, length);
+        if (delimiter == nullptr) {
+            break;
+        }
+        line.remove_prefix(length + 1);
+    }
+    if (fieldIndex != numFields) {
+        return LineStatus::Invalid;
+    }
+
+    for (const auto& predicate : spec.predicates) {
+        int32_t value;
+        if (!parseInt(value, fields[static_cast<size_t>(predicate.field)])) {
+            return LineStatus::Invalid;
+        }
+        if (!predicate.matches(value)) {
+            return LineStatus::Rejected;
+        }
+    }
+    // The rows are not initialized by the loader, so the fields outside of the projection are zeroed here
+    record = Relation{};
+    for (size_t field = 0; field < numFields; ++field) {
+        if (spec.projection.contains(field) && !assignValueFromString(record, fields[field], field)) {
+            return LineStatus::Invalid;
+        }
+    }
+    return LineStatus::Accepted;
+}
+
+// Parallel load (see load) of the tuples that satisfy the predicates of spec, with only its
+// projected fields parsed. numberOfTuples counts loaded tuples, not lines.
+template <typename Relation>
+RelationVector<Relation> scan(const std::string& filename, const ScanSpec<Relation>& spec, const size_t numberOfTuples = SIZE_MAX, const int numThreads = defaultLoadThreads()) {
+    if (!validPredicates<Relation>(spec.predicates)) {
+        return {};
+    }
+    return loadLines<Relation, RelationVector<Relation>>(filename, [&](std::string_view line, RelationVector<Relation>& data, const size_t index) {
+        return parseProjectedLine(line, data[index], spec);
+    }, numberOfTuples, numThreads);
+}
+
+inline RelationVector<CastRelation> scanCastRelation(const std::string& filename, const ScanSpec<CastRelation>& spec, const size_t numberOfTuples = SIZE_MAX,
+                                                  const int numThreads = defaultLoadThreads()) {
+    return scan(filename, spec, numberOfTuples, numThreads);
+}
+
+inline RelationVector<TitleRelation> scanTitleRelation(const std::string& filename, const ScanSpec<TitleRelation>& spec, const size_t numberOfTuples = SIZE_MAX,
+                                                    const int numThreads = defaultLoadThreads()) {
+    return scan(filename, spec, numberOfTuples, numThreads);
+}
+
+//==--------------------------------------------------------------------==//
+//==------------------------- PROJECTED JOIN ---------------------------==//
+//==--------------------------------------------------------------------==//
+
+// Predicates and output columns of performProjectedJoin
+struct JoinQuery {
+    std::vector<CastPredicate> castPredicates;
+    std::vector<TitlePredicate> titlePredicates;
+    FieldSet<CastField> castProjection = FieldSet<CastField>::all();
+    FieldSet<TitleField> titleProjection = FieldSet<TitleField>::all();
+};
+
+// Result of performProjectedJoin in columnar form. Row i of every projected column belongs to the
+// i-th match; the columns outside of the projections stay empty.
+struct ProjectedJoinResult {
+    FieldSet<CastField> castProjection;
+    FieldSet<TitleField> titleProjection;
+    CastColumns cast = {};
+    TitleColumns title = {};
+    size_t numRows = 0;
+
+    [[nodiscard]] size_t size() const { return numRows; }
+    [[nodiscard]] bool empty() const { return numRows == 0; }
+
+    // Bytes held by the projected columns
+    [[nodiscard]] size_t bytes() const {
+        size_t total = 0;
+        const auto add = [&](const auto& column) { total += column.size() * sizeof(column[0]); };
+        CastColumns::forEachColumn(cast, add);
+        TitleColumns::forEachColumn(title, add);
+        return total;
+    }
+};
+
+#endif // PUSHDOWN_HPP
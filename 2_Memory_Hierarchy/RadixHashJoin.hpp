@@ -0,0 +1,235 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef RADIXHASHJOIN_HPP
+#define RADIXHASHJOIN_HPP
+
+#include "Join.hpp"
+#include "CacheInfo.hpp"
+#include <omp.h>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+//==--------------------------------------------------------------------==//
+//==------------------ PARALLEL RADIX HASH JOIN ------------------------==//
+//==--------------------------------------------------------------------==//
+
+// Join key together with the row id of its tuple. Only these 8 byte pairs are
+// partitioned, the fat relation tuples stay where they are.
+struct RadixTuple {
+    int32_t key;
+    uint32_t row;
+};
+
+// Build side partitions (tuples plus their hash table) should fit into half of the L2
+inline size_t radixPartitionTargetBytes() {
+    return cacheSizes().l2 / 2;
+}
+// Fan-out of one partitioning pass. More open output partitions than this thrash the
+// TLB and the L1, so larger fan-outs are split into two passes.
+static constexpr unsigned RADIX_MAX_BITS_PER_PASS = 8;
+// Bytes per build tuple inside a partition: the RadixTuple plus bucket head and chain entry
+static constexpr size_t RADIX_BYTES_PER_BUILD_TUPLE = sizeof(RadixTuple) + 2 * sizeof(uint32_t);
+static constexpr uint32_t RADIX_CHAIN_END = UINT32_MAX;
+
+// Murmur3 finalizer, so dense or clustered keys still spread over all partitions
+inline uint32_t radixHash(int32_t key) {
+    auto h = static_cast<uint32_t>(key);
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+// Total number of radix bits, so that every build partition fits radixPartitionTargetBytes()
+// and there are enough partitions to keep all threads busy
+inline unsigned radixBits(size_t buildSize, int numThreads) {
+    const size_t by_cache = std::bit_ceil(std::max<size_t>(buildSize * RADIX_BYTES_PER_BUILD_TUPLE / radixPartitionTargetBytes(), 1));
+    const size_t by_threads = std::bit_ceil(static_cast<size_t>(std::max(numThreads, 1)) * 4);
+    const auto bits = static_cast<unsigned>(std::countr_zero(std::max(by_cache, by_threads)));
+    return std::min(bits, 2 * RADIX_MAX_BITS_PER_PASS);
+}
+
+// Serial radix scatter of input[0, size) into output[0, size) by hash bits [shift, shift + bits).
+// partitionBegin receives 2^bits + 1 partition boundaries relative to output.
+inline void radixScatter(const RadixTuple* input, RadixTuple* output, size_t size, unsigned shift, unsigned bits, size_t* partitionBegin) {
+    const size_t fanout = size_t{1} << bits;
+    const uint32_t mask = static_cast<uint32_t>(fanout - 1);
+
+    std::fill(partitionBegin, partitionBegin + fanout + 1, 0);
+    for (size_t i = 0; i < size; ++i) {
+        partitionBegin[((radixHash(input[i].key) >> shift) & mask) + 1]++;
+    }
+    std::partial_sum(partitionBegin, partitionBegin + fanout + 1, partitionBegin);
+
+    std::vector<size_t> write_positions(partitionBegin, partitionBegin + fanout);
+    for (size_t i = 0; i < size; ++i) {
+        output[write_positions[(radixHash(input[i].key) >> shift) & mask]++] = input[i];
+    }
+}
+
+// Radix partitions the keys of a relation into 2^bits partitions by the low hash bits.
+// The first pass runs in parallel (per-thread histograms, prefix sum, scatter), a second
+// pass refines every first-pass partition independently when bits exceeds the fan-out limit.
+// Returns the partitioned (key, row) pairs; partitionBounds receives 2^bits + 1 boundaries.
+template <typename Keys>
+std::vector<RadixTuple> radixPartition(const Keys& keys, unsigned bits, int numThreads, std::vector<size_t>& partitionBounds) {
+    const unsigned first_bits = std::min(bits, RADIX_MAX_BITS_PER_PASS);
+    const unsigned second_bits = bits - first_bits;
+    const size_t first_fanout = size_t{1} << first_bits;
+    const uint32_t first_mask = static_cast<uint32_t>(first_fanout - 1);
+    const size_t size = keys.size();
+    const int num_chunks = std::max(numThreads, 1);
+
+    // Pass 1: per-chunk histograms
+    std::vector<size_t> histograms(num_chunks * first_fanout, 0);
+#pragma omp parallel for schedule(static) num_threads(numThreads) shared(keys, histograms)
+    for (int chunk = 0; chunk < num_chunks; ++chunk) {
+        size_t* histogram = histograms.data() + chunk * first_fanout;
+        for (size_t i = chunk * size / num_chunks; i < (chunk + 1) * size / num_chunks; ++i) {
+            histogram[radixHash(keys[i]) & first_mask]++;
+        }
+    }
+
+    // Exclusive prefix sum in partition-major order gives every chunk its write cursor per partition
+    std::vector<size_t> first_bounds(first_fanout + 1, 0);
+    size_t offset = 0;
+    for (size_t partition = 0; partition < first_fanout; ++partition) {
+        first_bounds[partition] = offset;
+        for (int chunk = 0; chunk < num_chunks; ++chunk) {
+            const size_t count = histograms[chunk * first_fanout + partition];
+            histograms[chunk * first_fanout + partition] = offset;
+            offset += count;
+        }
+    }
+    first_bounds[first_fanout] = offset;
+
+    std::vector<RadixTuple> partitioned(size);
+#pragma omp parallel for schedule(static) num_threads(numThreads) shared(keys, histograms, partitioned)
+    for (int chunk = 0; chunk < num_chunks; ++chunk) {
+        size_t* cursor = histograms.data() + chunk * first_fanout;
+        for (size_t i = chunk * size / num_chunks; i < (chunk + 1) * size / num_chunks; ++i) {
+            const int32_t key = keys[i];
+            partitioned[cursor[radixHash(key) & first_mask]++] = {key, static_cast<uint32_t>(i)};
+        }
+    }
+
+    if (second_bits == 0) {
+        partitionBounds = std::move(first_bounds);
+        return partitioned;
+    }
+
+    // Pass 2: every first-pass partition is refined on its own, partitions are spread over the threads
+    const size_t second_fanout = size_t{1} << second_bits;
+    std::vector<RadixTuple> refined(size);
+    partitionBounds.assign(first_fanout * second_fanout + 1, 0);
+#pragma omp parallel for schedule(dynamic) num_threads(numThreads) shared(first_bounds, partitioned, refined, partitionBounds)
+    for (int partition = 0; partition < static_cast<int>(first_fanout); ++partition) {
+        const size_t begin = first_bounds[partition];
+        std::vector<size_t> local_bounds(second_fanout + 1);
+        radixScatter(partitioned.data() + begin, refined.data() + begin, first_bounds[partition + 1] - begin,
+                     first_bits, second_bits, local_bounds.data());
+        for (size_t sub = 0; sub < second_fanout; ++sub) {
+            partitionBounds[partition * second_fanout + sub] = begin + local_bounds[sub];
+        }
+    }
+    partitionBounds.back() = size;
+    return refined;
+}
+
+// Builds a bucket-chained hash table over one title partition and probes it with the matching
+// cast partition. head and next are reused across partitions by the calling thread.
+template <typename EmitPair>
+void buildAndProbePartition(const RadixTuple* build, size_t buildSize, const RadixTuple* probe, size_t probeSize, unsigned shift,
+                            std::vector<uint32_t>& head, std::vector<uint32_t>& next, EmitPair&& emitPair) {
+    if (buildSize == 0 || probeSize == 0) {
+        return;
+    }
+    const size_t buckets = std::bit_ceil(buildSize);
+    const uint32_t mask = static_cast<uint32_t>(buckets - 1);
+    head.assign(buckets, RADIX_CHAIN_END);
+    next.resize(buildSize);
+
+    for (size_t i = 0; i < buildSize; ++i) {
+        const uint32_t bucket = (radixHash(build[i].key) >> shift) & mask;
+        next[i] = head[bucket];
+        head[bucket] = static_cast<uint32_t>(i);
+    }
+
+    for (size_t i = 0; i < probeSize; ++i) {
+        const int32_t key = probe[i].key;
+        for (uint32_t entry = head[(radixHash(key) >> shift) & mask]; entry != RADIX_CHAIN_END; entry = next[entry]) {
+            if (build[entry].key == key) {
+                emitPair(probe[i].row, build[entry].row);
+            }
+        }
+    }
+}
+
+// Joins two unsorted relations given by their join keys. Both sides are radix partitioned on
+// the same hash bits, then every partition pair is joined by an in-cache build (title side)
+// and probe (cast side). Calls emit(partition, cast_row, title_row) for every match, on the
+// OpenMP thread that joins the partition.
+template <typename CastKeys, typename TitleKeys, typename Emit>
+void radixHashJoinForEach(const CastKeys& castKeys, const TitleKeys& titleKeys, int numThreads, Emit&& emit) {
+    const unsigned bits = radixBits(titleKeys.size(), numThreads);
+    std::vector<size_t> cast_bounds;
+    std::vector<size_t> title_bounds;
+    const std::vector<RadixTuple> cast_partitioned = radixPartition(castKeys, bits, numThreads, cast_bounds);
+    const std::vector<RadixTuple> title_partitioned = radixPartition(titleKeys, bits, numThreads, title_bounds);
+    const size_t num_partitions = size_t{1} << bits;
+
+#pragma omp parallel num_threads(numThreads) shared(cast_partitioned, title_partitioned, cast_bounds, title_bounds, emit)
+    {
+        std::vector<uint32_t> head;
+        std::vector<uint32_t> next;
+#pragma omp for schedule(dynamic)
+        for (int partition = 0; partition < static_cast<int>(num_partitions); ++partition) {
+            buildAndProbePartition(title_partitioned.data() + title_bounds[partition], title_bounds[partition + 1] - title_bounds[partition],
+                                   cast_partitioned.data() + cast_bounds[partition], cast_bounds[partition + 1] - cast_bounds[partition],
+                                   bits, head, next, [&](uint32_t cast_row, uint32_t title_row) {
+                                       emit(static_cast<size_t>(partition), cast_row, title_row);
+                                   });
+        }
+    }
+}
+
+// Row ids of all matches of radixHashJoinForEach, grouped by partition
+template <typename CastKeys, typename TitleKeys>
+JoinIndexVector radixHashJoin(const CastKeys& castKeys, const TitleKeys& titleKeys, int numThreads) {
+    const size_t num_partitions = size_t{1} << radixBits(titleKeys.size(), numThreads);
+    std::vector<std::vector<JoinIndexPair>> partition_results(num_partitions);
+    radixHashJoinForEach(castKeys, titleKeys, numThreads, [&](size_t partition, uint32_t cast_row, uint32_t title_row) {
+        partition_results[partition].push_back({cast_row, title_row});
+    });
+
+    // The per-partition results are only 8 bytes per match, so gathering them is cheap
+    std::vector<size_t> offsets(num_partitions + 1, 0);
+    for (size_t partition = 0; partition < num_partitions; ++partition) {
+        offsets[partition + 1] = offsets[partition] + partition_results[partition].size();
+    }
+    JoinIndexVector indexPairs(offsets.back());
+#pragma omp parallel for schedule(dynamic) num_threads(numThreads) shared(partition_results, offsets, indexPairs)
+    for (int partition = 0; partition < static_cast<int>(num_partitions); ++partition) {
+        std::copy(partition_results[partition].begin(), partition_results[partition].end(), indexPairs.begin() + offsets[partition]);
+    }
+    return indexPairs;
+}
+
+#endif // RADIXHASHJOIN_HPP
@@ -0,0 +1,269 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef RELATIONSNAPSHOT_HPP
+#define RELATIONSNAPSHOT_HPP
+
+#include "ColumnarRelation.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//==--------------------------------------------------------------------==//
+//==------------------ BINARY COLUMNAR SNAPSHOTS -----------------------==//
+//==--------------------------------------------------------------------==//
+
+// A snapshot file stores a CastColumns/TitleColumns relation as
+//   [SnapshotHeader, zero padded to SNAPSHOT_ALIGNMENT]
+//   [column 0, zero padded to SNAPSHOT_ALIGNMENT] ... [column n - 1, zero padded]
+// Every column section holds rowCount fixed size values exactly as they lie in the column,
+// so a reloaded relation is one private mmap whose sections become the columns, without any
+// parsing or copying.
+
+static constexpr char SNAPSHOT_MAGIC[8] = {'P', 'P', 'D', 'S', 'C', 'O', 'L', 'S'};
+static constexpr uint32_t SNAPSHOT_VERSION = 1;
+static constexpr size_t SNAPSHOT_ALIGNMENT = 4096;
+static constexpr size_t SNAPSHOT_MAX_COLUMNS = 16;
+
+enum class SnapshotSchema : uint32_t {
+    Cast = 1,
+    Title = 2,
+};
+
+struct SnapshotColumn {
+    uint64_t offset;      // File offset of the section, a multiple of SNAPSHOT_ALIGNMENT
+    uint64_t elementSize; // Bytes per value
+};
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    SnapshotSchema schema;
+    uint64_t rowCount;
+    uint32_t numberOfColumns;
+    // The key column (movieId/titleId) is sorted ascending
+    uint32_t sortedByKey;
+    // The snapshot holds every valid line of its source file, not only the first numberOfTuples
+    uint32_t complete;
+    uint32_t reserved;
+    // Size and modification time of the CSV file the snapshot was built from
+    uint64_t sourceSize;
+    int64_t sourceModified;
+    SnapshotColumn columns[SNAPSHOT_MAX_COLUMNS];
+};
+static_assert(sizeof(SnapshotHeader) <= SNAPSHOT_ALIGNMENT);
+
+// Identity of a CSV file; a snapshot whose recorded source differs is stale
+struct SnapshotSource {
+    bool exists = false;
+    uint64_t size = 0;
+    int64_t modified = 0;
+};
+
+inline SnapshotSource snapshotSource(const std::string& filename) {
+    struct stat fileStat{};
+    if (stat(filename.c_str(), &fileStat) != 0) {
+        return {};
+    }
+    return {true, static_cast<uint64_t>(fileStat.st_size), fileStat.st_mtim.tv_sec * 1000000000LL + fileStat.st_mtim.tv_nsec};
+}
+
+// Snapshot file that belongs to a CSV file
+inline std::string snapshotFilename(const std::string& csvFilename) {
+    return csvFilename + ".colsnap";
+}
+
+inline SnapshotSchema snapshotSchema(const CastColumns&) { return SnapshotSchema::Cast; }
+inline SnapshotSchema snapshotSchema(const TitleColumns&) { return SnapshotSchema::Title; }
+
+inline std::span<const int32_t> snapshotKeys(const CastColumns& columns) { return columns.movieId; }
+inline std::span<const int32_t> snapshotKeys(const TitleColumns& columns) { return columns.titleId; }
+
+inline uint64_t alignSnapshotOffset(uint64_t offset) {
+    return (offset + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+}
+
+// Header of a snapshot with rowCount rows of Columns. The column sections follow each other in
+// schema order, so a writer that produces rows block by block can fill them at their offsets.
+template <typename Columns>
+SnapshotHeader createSnapshotHeader(uint64_t rowCount, bool sortedByKey, const SnapshotSource& source = {}, bool complete = true) {
+    const Columns layout;
+    SnapshotHeader header{};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.schema = snapshotSchema(layout);
+    header.rowCount = rowCount;
+    header.sortedByKey = sortedByKey;
+    header.complete = complete;
+    header.sourceSize = source.size;
+    header.sourceModified = source.modified;
+
+    uint64_t offset = SNAPSHOT_ALIGNMENT;
+    Columns::forEachColumn(layout, [&](const auto& column) {
+        SnapshotColumn& entry = header.columns[header.numberOfColumns++];
+        entry.offset = offset;
+        entry.elementSize = sizeof(typename std::decay_t<decltype(column)>::value_type);
+        offset = alignSnapshotOffset(offset + rowCount * entry.elementSize);
+    });
+    return header;
+}
+
+// Size of a snapshot file with the given header
+inline uint64_t snapshotFileSize(const SnapshotHeader& header) {
+    if (header.numberOfColumns == 0) {
+        return SNAPSHOT_ALIGNMENT;
+    }
+    const SnapshotColumn& last = header.columns[header.numberOfColumns - 1];
+    return alignSnapshotOffset(last.offset + header.rowCount * last.elementSize);
+}
+
+// Writes columns as a snapshot. The data goes to a temporary file that is renamed at the end,
+// so a reader never maps a half written snapshot. Returns false if the file could not be written.
+template <typename Columns>
+bool writeSnapshot(const std::string& filename, const Columns& columns, const SnapshotSource& source = {}, bool complete = true) {
+    const SnapshotHeader header = createSnapshotHeader<Columns>(columns.size(), std::ranges::is_sorted(snapshotKeys(columns)), source, complete);
+
+    const std::string temporary = filename + ".tmp";
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        return false;
+    }
+    static const char padding[SNAPSHOT_ALIGNMENT] = {};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(padding, SNAPSHOT_ALIGNMENT - sizeof(header));
+    Columns::forEachColumn(columns, [&](const auto& column) {
+        const size_t bytes = column.size() * sizeof(typename std::decay_t<decltype(column)>::value_type);
+        file.write(reinterpret_cast<const char*>(column.data()), static_cast<std::streamsize>(bytes));
+        file.write(padding, static_cast<std::streamsize>(alignSnapshotOffset(bytes) - bytes));
+    });
+    file.close();
+
+    std::error_code error;
+    if (file.fail()) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    std::filesystem::rename(temporary, filename, error);
+    return !error;
+}
+
+// Checks that a mapped snapshot matches the compiled layout of Columns and lies inside the file
+template <typename Columns>
+bool validateSnapshot(const MappedFile& file, const SnapshotHeader& header) {
+    const Columns layout;
+    if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 || header.version != SNAPSHOT_VERSION ||
+        header.schema != snapshotSchema(layout)) {
+        return false;
+    }
+
+    bool valid = true;
+    uint32_t index = 0;
+    Columns::forEachColumn(layout, [&](const auto& column) {
+        const size_t elementSize = sizeof(typename std::decay_t<decltype(column)>::value_type);
+        if (index >= header.numberOfColumns) {
+            valid = false;
+            return;
+        }
+        const SnapshotColumn& entry = header.columns[index++];
+        valid = valid && entry.elementSize == elementSize && entry.offset % SNAPSHOT_ALIGNMENT == 0 &&
+                entry.offset <= file.size() && header.rowCount <= (file.size() - entry.offset) / elementSize;
+    });
+    return valid && index == header.numberOfColumns;
+}
+
+// Maps a snapshot and makes columns views over the first numberOfTuples rows of its sections.
+// The mapping is private and lives as long as one of the columns does; writes to the columns stay
+// in memory. The key order of the header is passed on in columns.sortedByKey. If expectedSource
+// is given, snapshots of another version of the CSV file are rejected, as are incomplete
+// snapshots with fewer than numberOfTuples rows. Returns false (and leaves columns untouched)
+// on rejection.
+template <typename Columns>
+bool readSnapshot(const std::string& filename, Columns& columns, const size_t numberOfTuples = SIZE_MAX, const SnapshotSource* expectedSource = nullptr,
+                  SnapshotHeader* headerOut = nullptr) {
+    const auto file = std::make_shared<const MappedFile>(filename, true);
+    if (!file->isOpen() || file->size() < sizeof(SnapshotHeader)) {
+        return false;
+    }
+    SnapshotHeader header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (!validateSnapshot<Columns>(*file, header)) {
+        std::cerr << "Warning: Ignoring invalid snapshot " << filename << std::endl;
+        return false;
+    }
+    if (expectedSource != nullptr && expectedSource->exists &&
+        (header.sourceSize != expectedSource->size || header.sourceModified != expectedSource->modified)) {
+        return false;
+    }
+    if (!header.complete && header.rowCount < numberOfTuples) {
+        return false;
+    }
+
+    const size_t rows = std::min<uint64_t>(header.rowCount, numberOfTuples);
+    Columns mapped;
+    uint32_t index = 0;
+    Columns::forEachColumn(mapped, [&](auto& column) {
+        using Value = typename std::decay_t<decltype(column)>::value_type;
+        auto* values = reinterpret_cast<Value*>(file->writableData() + header.columns[index++].offset);
+        column = {file, values, rows};
+    });
+    mapped.sortedByKey = header.sortedByKey != 0;
+    columns = std::move(mapped);
+
+    if (headerOut != nullptr) {
+        *headerOut = header;
+    }
+    return true;
+}
+
+// Loads a relation from the snapshot next to its CSV file. Without a usable snapshot the CSV
+// is parsed and the snapshot is written for the next run. If the CSV file is gone, an existing
+// snapshot is used as it is.
+template <typename Relation, typename Columns>
+Columns loadWithSnapshot(const std::string& filename, const size_t numberOfTuples = SIZE_MAX, const int numThreads = defaultLoadThreads()) {
+    const std::string snapshot = snapshotFilename(filename);
+    const SnapshotSource source = snapshotSource(filename);
+
+    Columns columns;
+    if (readSnapshot(snapshot, columns, numberOfTuples, &source)) {
+        std::cout << "Loaded " << columns.size() << " tuples from snapshot " << snapshot << "." << std::endl;
+        return columns;
+    }
+
+    columns = load<Relation, Columns>(filename, numberOfTuples, numThreads);
+    // Fewer tuples than requested means the whole file was read
+    const bool complete = columns.size() < numberOfTuples;
+    if (!writeSnapshot(snapshot, columns, source, complete)) {
+        std::cerr << "Warning: Failed to write snapshot " << snapshot << std::endl;
+    }
+    return columns;
+}
+
+inline CastColumns loadCastColumnsWithSnapshot(const std::string& filename, const size_t numberOfTuples = SIZE_MAX, const int numThreads = defaultLoadThreads()) {
+    return loadWithSnapshot<CastRelation, CastColumns>(filename, numberOfTuples, numThreads);
+}
+
+inline TitleColumns loadTitleColumnsWithSnapshot(const std::string& filename, const size_t numberOfTuples = SIZE_MAX, const int numThreads = defaultLoadThreads()) {
+    return loadWithSnapshot<TitleRelation, TitleColumns>(filename, numberOfTuples, numThreads);
+}
+
+#endif // RELATIONSNAPSHOT_HPP
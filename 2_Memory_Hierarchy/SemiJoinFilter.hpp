@@ -0,0 +1,211 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef SEMIJOINFILTER_HPP
+#define SEMIJOINFILTER_HPP
+
+#include "Join.hpp"
+#include "DirectAddressJoin.hpp"
+#include <omp.h>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+//==--------------------------------------------------------------------==//
+//==---------------------- SEMI JOIN PREFILTER -------------------------==//
+//==--------------------------------------------------------------------==//
+
+// Filter bits per key of the smaller relation. With 4 bits set in one 64 bit word per key, a
+// register-blocked Bloom filter of this size lets about 1% of the non-matching keys through.
+static constexpr size_t SEMI_JOIN_BITS_PER_KEY = 16;
+static constexpr unsigned SEMI_JOIN_BLOOM_HASHES = 4;
+// Rows per task of the filter pass
+static constexpr size_t SEMI_JOIN_CHUNK = 16 * 1024;
+
+// What the prefilter of one join did
+struct PrefilterStats {
+    // SemiJoinPrefilter::Bloom or SemiJoinPrefilter::Bitmap, whichever was built
+    SemiJoinPrefilter filter = SemiJoinPrefilter::None;
+    // True if the cast relation was filtered by the title keys, false for the other way round
+    bool castFiltered = true;
+    size_t filterBytes = 0;
+    size_t inputTuples = 0;
+    // Tuples that passed the filter and went on to the partitioning or sorting phase
+    size_t passedTuples = 0;
+    // Tuples of the filtered side that have a join partner (known after the join)
+    size_t matchingTuples = 0;
+
+    [[nodiscard]] size_t droppedTuples() const { return inputTuples - passedTuples; }
+    // Fraction of the filtered side that reached the join
+    [[nodiscard]] double selectivity() const { return inputTuples == 0 ? 0.0 : static_cast<double>(passedTuples) / inputTuples; }
+    // Fraction of the non-matching tuples that the filter failed to drop
+    [[nodiscard]] double falsePositiveRate() const {
+        const size_t not_matching = inputTuples - matchingTuples;
+        return not_matching == 0 ? 0.0 : static_cast<double>(passedTuples - matchingTuples) / not_matching;
+    }
+};
+
+// Membership filter over the join keys of one relation. A Bitmap has one bit per key of the
+// dense range [minKey, minKey + 64 * words.size()) and is exact; a Bloom filter sets
+// SEMI_JOIN_BLOOM_HASHES bits inside a single word per key, so a lookup costs one cache miss.
+class SemiJoinFilter {
+  public:
+    // Builds the requested filter in parallel; Auto (and Bitmap on a sparse range) picks the
+    // bitmap only if it is not larger than the Bloom filter
+    template <typename Keys>
+    static SemiJoinFilter build(const Keys& keys, SemiJoinPrefilter kind, int numThreads) {
+        SemiJoinFilter filter;
+        const size_t bloom_words = std::bit_ceil(std::max<size_t>(keys.size() * SEMI_JOIN_BITS_PER_KEY / 64, 1));
+        const KeyRange range = keyRange(keys, numThreads);
+        const auto bitmap_words = static_cast<size_t>((range.domain() + 63) / 64);
+        if (kind != SemiJoinPrefilter::Bloom && keys.size() != 0 && bitmap_words <= bloom_words) {
+            filter.kind = SemiJoinPrefilter::Bitmap;
+            filter.minKey = range.min;
+            filter.words.assign(bitmap_words, 0);
+        } else {
+            filter.kind = SemiJoinPrefilter::Bloom;
+            filter.shift = 64 - std::countr_zero(bloom_words);
+            filter.words.assign(bloom_words, 0);
+        }
+
+#pragma omp parallel for schedule(static) num_threads(numThreads) shared(keys, filter)
+        for (size_t i = 0; i < keys.size(); ++i) {
+            const auto [word, bits] = filter.position(keys[i]);
+            std::atomic_ref<uint64_t>(filter.words[word]).fetch_or(bits, std::memory_order_relaxed);
+        }
+        return filter;
+    }
+
+    [[nodiscard]] bool mayContain(int32_t key) const {
+        if (kind == SemiJoinPrefilter::Bitmap) {
+            const auto offset = static_cast<uint64_t>(static_cast<int64_t>(key) - minKey);
+            if (offset >= 64 * words.size()) {
+                return false;
+            }
+        }
+        const auto [word, bits] = position(key);
+        return (words[word] & bits) == bits;
+    }
+
+    [[nodiscard]] SemiJoinPrefilter getKind() const { return kind; }
+    [[nodiscard]] size_t sizeBytes() const { return words.size() * sizeof(uint64_t); }
+
+  private:
+    struct Position {
+        size_t word;
+        uint64_t bits;
+    };
+
+    // Word and bit mask of a key; for the bitmap the key has to be inside the range
+    [[nodiscard]] Position position(int32_t key) const {
+        if (kind == SemiJoinPrefilter::Bitmap) {
+            const auto offset = static_cast<uint64_t>(static_cast<int64_t>(key) - minKey);
+            return {offset / 64, uint64_t{1} << (offset % 64)};
+        }
+        // Murmur3 64 bit finalizer; the top bits select the word, the low bits the bits in it
+        auto h = static_cast<uint64_t>(static_cast<uint32_t>(key));
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        uint64_t bits = 0;
+        for (unsigned i = 0; i < SEMI_JOIN_BLOOM_HASHES; ++i) {
+            bits |= uint64_t{1} << ((h >> (6 * i)) & 63);
+        }
+        return {shift == 64 ? 0 : static_cast<size_t>(h >> shift), bits};
+    }
+
+    SemiJoinPrefilter kind = SemiJoinPrefilter::None;
+    int32_t minKey = 0;
+    unsigned shift = 64;
+    std::vector<uint64_t> words;
+};
+
+// Row ids i in [0, size) for which keep(i) holds, in ascending order. Chunks are checked in
+// parallel and concatenated in chunk order.
+template <typename Keep>
+std::vector<uint32_t> selectRows(size_t size, Keep&& keep, int numThreads) {
+    const size_t num_chunks = (size + SEMI_JOIN_CHUNK - 1) / SEMI_JOIN_CHUNK;
+    std::vector<std::vector<uint32_t>> chunk_rows(num_chunks);
+
+#pragma omp parallel for schedule(dynamic) num_threads(numThreads) shared(keep, chunk_rows)
+    for (size_t chunk = 0; chunk < num_chunks; ++chunk) {
+        const size_t end = std::min((chunk + 1) * SEMI_JOIN_CHUNK, size);
+        for (size_t i = chunk * SEMI_JOIN_CHUNK; i < end; ++i) {
+            if (keep(i)) {
+                chunk_rows[chunk].push_back(static_cast<uint32_t>(i));
+            }
+        }
+    }
+
+    std::vector<size_t> offsets(num_chunks + 1, 0);
+    for (size_t chunk = 0; chunk < num_chunks; ++chunk) {
+        offsets[chunk + 1] = offsets[chunk] + chunk_rows[chunk].size();
+    }
+    std::vector<uint32_t> rows(offsets.back());
+#pragma omp parallel for schedule(dynamic) num_threads(numThreads) shared(chunk_rows, offsets, rows)
+    for (size_t chunk = 0; chunk < num_chunks; ++chunk) {
+        std::copy(chunk_rows[chunk].begin(), chunk_rows[chunk].end(), rows.begin() + offsets[chunk]);
+    }
+    return rows;
+}
+
+// Tuples that passed a semi-join filter: their row ids and, at the same position, their keys
+struct FilteredRows {
+    UninitializedVector<uint32_t> rows;
+    UninitializedVector<int32_t> keys;
+};
+
+// Row ids and keys of all keys that may be contained in the filter, in ascending row order. Chunks
+// count their passing keys in parallel, a prefix sum gives every chunk its output slot, and a
+// second parallel pass writes the row ids and the keys next to each other, so the join reads the
+// passed keys densely instead of gathering them through the row ids.
+template <typename Keys>
+FilteredRows filterRows(const Keys& keys, const SemiJoinFilter& filter, int numThreads) {
+    const size_t num_chunks = (keys.size() + SEMI_JOIN_CHUNK - 1) / SEMI_JOIN_CHUNK;
+    std::vector<size_t> offsets(num_chunks + 1, 0);
+
+#pragma omp parallel for schedule(dynamic) num_threads(numThreads) shared(keys, filter, offsets)
+    for (size_t chunk = 0; chunk < num_chunks; ++chunk) {
+        const size_t end = std::min((chunk + 1) * SEMI_JOIN_CHUNK, keys.size());
+        size_t passed = 0;
+        for (size_t i = chunk * SEMI_JOIN_CHUNK; i < end; ++i) {
+            passed += filter.mayContain(keys[i]);
+        }
+        offsets[chunk + 1] = passed;
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+    FilteredRows result{UninitializedVector<uint32_t>(offsets.back()), UninitializedVector<int32_t>(offsets.back())};
+#pragma omp parallel for schedule(dynamic) num_threads(numThreads) shared(keys, filter, offsets, result)
+    for (size_t chunk = 0; chunk < num_chunks; ++chunk) {
+        const size_t end = std::min((chunk + 1) * SEMI_JOIN_CHUNK, keys.size());
+        size_t output = offsets[chunk];
+        for (size_t i = chunk * SEMI_JOIN_CHUNK; i < end; ++i) {
+            const int32_t key = keys[i];
+            if (filter.mayContain(key)) {
+                result.rows[output] = static_cast<uint32_t>(i);
+                result.keys[output] = key;
+                ++output;
+            }
+        }
+    }
+    return result;
+}
+
+#endif // SEMIJOINFILTER_HPP
@@ -0,0 +1,219 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef SIMDMERGEJOIN_HPP
+#define SIMDMERGEJOIN_HPP
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PPDS_SIMD_X86 1
+#endif
+
+//==--------------------------------------------------------------------==//
+//==------------------- SIMD MERGE JOIN ON INT32 KEYS ------------------==//
+//==--------------------------------------------------------------------==//
+
+// All kernels merge castKeys[castBegin, castEnd) with titleKeys[titleBegin, titleEnd)
+// and call emitRun(cast_begin, cast_end, title_index) for every run of cast keys that
+// equals one title key. Both key arrays have to be sorted. Because of that the keys of a
+// block that are smaller than (or equal to) a probe key always form a prefix of the
+// block, so the popcount of the compare mask is the number of keys to skip (or emit).
+
+enum class SimdLevel {
+    Scalar,
+    Avx2,
+    Avx512,
+};
+
+template <typename EmitRun>
+void mergeJoinKeysScalar(const int32_t* castKeys, size_t castBegin, size_t castEnd,
+                         const int32_t* titleKeys, size_t titleBegin, size_t titleEnd, EmitRun&& emitRun) {
+    size_t pointer_cast = castBegin;
+    size_t pointer_title = titleBegin;
+
+    while (pointer_cast < castEnd && pointer_title < titleEnd) {
+        if (castKeys[pointer_cast] < titleKeys[pointer_title]) {
+            pointer_cast++;
+        } else if (castKeys[pointer_cast] > titleKeys[pointer_title]) {
+            pointer_title++;
+        } else {
+            size_t run_end = pointer_cast;
+            while (run_end < castEnd && castKeys[run_end] == titleKeys[pointer_title]) {
+                run_end++;
+            }
+            emitRun(pointer_cast, run_end, pointer_title);
+            pointer_title++;
+        }
+    }
+}
+
+#ifdef PPDS_SIMD_X86
+
+// Number of leading keys in keys[begin, end) that are smaller than key
+__attribute__((target("avx2"))) inline size_t skipSmallerAvx2(const int32_t* keys, size_t begin, size_t end, int32_t key) {
+    const __m256i probe = _mm256_set1_epi32(key);
+    while (begin + 8 <= end) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + begin));
+        const auto smaller = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(probe, block))));
+        if (smaller != 0xFF) {
+            return begin + std::popcount(smaller);
+        }
+        begin += 8;
+    }
+    while (begin < end && keys[begin] < key) {
+        begin++;
+    }
+    return begin;
+}
+
+// Number of leading keys in keys[begin, end) that are equal to key
+__attribute__((target("avx2"))) inline size_t skipEqualAvx2(const int32_t* keys, size_t begin, size_t end, int32_t key) {
+    const __m256i probe = _mm256_set1_epi32(key);
+    while (begin + 8 <= end) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + begin));
+        const auto equal = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(probe, block))));
+        if (equal != 0xFF) {
+            return begin + std::popcount(equal);
+        }
+        begin += 8;
+    }
+    while (begin < end && keys[begin] == key) {
+        begin++;
+    }
+    return begin;
+}
+
+template <typename EmitRun>
+__attribute__((target("avx2"))) void mergeJoinKeysAvx2(const int32_t* castKeys, size_t castBegin, size_t castEnd,
+                                                       const int32_t* titleKeys, size_t titleBegin, size_t titleEnd, EmitRun&& emitRun) {
+    size_t pointer_cast = castBegin;
+    size_t pointer_title = titleBegin;
+
+    while (pointer_title < titleEnd) {
+        pointer_cast = skipSmallerAvx2(castKeys, pointer_cast, castEnd, titleKeys[pointer_title]);
+        if (pointer_cast == castEnd) {
+            break;
+        }
+        if (castKeys[pointer_cast] > titleKeys[pointer_title]) {
+            pointer_title = skipSmallerAvx2(titleKeys, pointer_title, titleEnd, castKeys[pointer_cast]);
+            continue;
+        }
+        emitRun(pointer_cast, skipEqualAvx2(castKeys, pointer_cast, castEnd, titleKeys[pointer_title]), pointer_title);
+        pointer_title++;
+    }
+}
+
+__attribute__((target("avx512f"))) inline size_t skipSmallerAvx512(const int32_t* keys, size_t begin, size_t end, int32_t key) {
+    const __m512i probe = _mm512_set1_epi32(key);
+    while (begin + 16 <= end) {
+        const __mmask16 smaller = _mm512_cmplt_epi32_mask(_mm512_loadu_si512(keys + begin), probe);
+        if (smaller != 0xFFFF) {
+            return begin + std::popcount(static_cast<uint32_t>(smaller));
+        }
+        begin += 16;
+    }
+    while (begin < end && keys[begin] < key) {
+        begin++;
+    }
+    return begin;
+}
+
+__attribute__((target("avx512f"))) inline size_t skipEqualAvx512(const int32_t* keys, size_t begin, size_t end, int32_t key) {
+    const __m512i probe = _mm512_set1_epi32(key);
+    while (begin + 16 <= end) {
+        const __mmask16 equal = _mm512_cmpeq_epi32_mask(_mm512_loadu_si512(keys + begin), probe);
+        if (equal != 0xFFFF) {
+            return begin + std::popcount(static_cast<uint32_t>(equal));
+        }
+        begin += 16;
+    }
+    while (begin < end && keys[begin] == key) {
+        begin++;
+    }
+    return begin;
+}
+
+template <typename EmitRun>
+__attribute__((target("avx512f"))) void mergeJoinKeysAvx512(const int32_t* castKeys, size_t castBegin, size_t castEnd,
+                                                            const int32_t* titleKeys, size_t titleBegin, size_t titleEnd, EmitRun&& emitRun) {
+    size_t pointer_cast = castBegin;
+    size_t pointer_title = titleBegin;
+
+    while (pointer_title < titleEnd) {
+        pointer_cast = skipSmallerAvx512(castKeys, pointer_cast, castEnd, titleKeys[pointer_title]);
+        if (pointer_cast == castEnd) {
+            break;
+        }
+        if (castKeys[pointer_cast] > titleKeys[pointer_title]) {
+            pointer_title = skipSmallerAvx512(titleKeys, pointer_title, titleEnd, castKeys[pointer_cast]);
+            continue;
+        }
+        emitRun(pointer_cast, skipEqualAvx512(castKeys, pointer_cast, castEnd, titleKeys[pointer_title]), pointer_title);
+        pointer_title++;
+    }
+}
+
+// Writes the pairs (castBegin, titleIndex) ... (castEnd - 1, titleIndex) as consecutive
+// {uint32_t castIndex, uint32_t titleIndex} records, four per store. The bounds are compared as
+// size_t; the row ids themselves have to fit into uint32_t (see fitsRowIds).
+__attribute__((target("avx2"))) inline void writeIndexRunAvx2(void* output, size_t castBegin, size_t castEnd, uint32_t titleIndex) {
+    auto* out = static_cast<char*>(output);
+    const uint64_t first_pair = (static_cast<uint64_t>(titleIndex) << 32) | castBegin;
+    __m256i pairs = _mm256_add_epi64(_mm256_set1_epi64x(static_cast<int64_t>(first_pair)), _mm256_setr_epi64x(0, 1, 2, 3));
+    const __m256i step = _mm256_set1_epi64x(4);
+    size_t cast_index = castBegin;
+    for (; cast_index + 4 <= castEnd; cast_index += 4) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), pairs);
+        pairs = _mm256_add_epi64(pairs, step);
+        out += 4 * sizeof(uint64_t);
+    }
+    for (; cast_index < castEnd; ++cast_index) {
+        const uint64_t pair = (static_cast<uint64_t>(titleIndex) << 32) | cast_index;
+        std::memcpy(out, &pair, sizeof(pair));
+        out += sizeof(pair);
+    }
+}
+
+#endif // PPDS_SIMD_X86
+
+// Widest kernel the CPU supports, determined once via CPUID
+inline SimdLevel detectSimdLevel() {
+#ifdef PPDS_SIMD_X86
+    static const SimdLevel level = __builtin_cpu_supports("avx512f") ? SimdLevel::Avx512
+                                   : __builtin_cpu_supports("avx2")  ? SimdLevel::Avx2
+                                                                     : SimdLevel::Scalar;
+    return level;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+template <typename EmitRun>
+void mergeJoinKeys(SimdLevel level, const int32_t* castKeys, size_t castBegin, size_t castEnd,
+                   const int32_t* titleKeys, size_t titleBegin, size_t titleEnd, EmitRun&& emitRun) {
+    switch (level) {
+#ifdef PPDS_SIMD_X86
+        case SimdLevel::Avx512: mergeJoinKeysAvx512(castKeys, castBegin, castEnd, titleKeys, titleBegin, titleEnd, emitRun); break;
+        case SimdLevel::Avx2: mergeJoinKeysAvx2(castKeys, castBegin, castEnd, titleKeys, titleBegin, titleEnd, emitRun); break;
+#endif
+        default: mergeJoinKeysScalar(castKeys, castBegin, castEnd, titleKeys, titleBegin, titleEnd, emitRun); break;
+    }
+}
+
+#endif // SIMDMERGEJOIN_HPP
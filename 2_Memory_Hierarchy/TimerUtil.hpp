@@ -15,6 +15,7 @@
 #ifndef TIMERUTIL_HPP
 #define TIMERUTIL_HPP
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <chrono>
@@ -32,10 +33,15 @@ template<typename TimeUnit = std::chrono::nanoseconds,
          typename ClockType = std::chrono::high_resolution_clock>
 class Timer {
   public:
+    /**
+     * @brief named value measured alongside the runtime, e.g. a hardware counter
+     */
+    using Metric = std::pair<std::string, double>;
+
     class Snapshot {
       public:
-        Snapshot(std::string name, TimeUnit runtime, std::vector<Snapshot> children)
-            : name(std::move(name)), runtime(runtime), children(children){};
+        Snapshot(std::string name, TimeUnit runtime, std::vector<Snapshot> children, std::vector<Metric> metrics = {})
+            : name(std::move(name)), runtime(runtime), children(children), metrics(std::move(metrics)){};
         int64_t getRuntime() { return runtime.count(); }
         PrintTimePrecision getPrintTime() {
             return std::chrono::duration_cast<std::chrono::duration<PrintTimePrecision, PrintTimeUnit>>(runtime).count();
@@ -44,6 +50,7 @@ class Timer {
         std::string name;
         TimeUnit runtime;
         std::vector<Snapshot> children;
+        std::vector<Metric> metrics;
     };
 
     explicit Timer(std::string componentName) : componentName(std::move(componentName)){};
@@ -104,6 +111,27 @@ class Timer {
         }
     };
 
+    /**
+     * @brief saves current runtime as a snapshot together with values
+     * measured over the same interval and optional sub-snapshots
+     * @param snapshotName the of the snapshot
+     * @param metrics values printed next to the runtime
+     * @param children nested snapshots, e.g. one per thread
+     */
+    void snapshot(std::string snapshotName, std::vector<Metric> metrics, std::vector<Snapshot> children = {}) {
+        if (!running) {
+            std::cout << "Timer: Trying to take a snapshot of an non-running timer so will skip this operation\n";
+        } else {
+            stop_p = ClockType::now();
+            auto duration = std::chrono::duration_cast<TimeUnit>(stop_p - start_p);
+
+            runtime += duration;
+            snapshots.emplace_back(Snapshot(createFullyQualifiedSnapShotName(snapshotName), duration, std::move(children), std::move(metrics)));
+
+            start_p = ClockType::now();
+        }
+    };
+
     /**
      * @brief includes snapshots of another timer
      * instance into this instance and adds overall
@@ -199,6 +227,9 @@ class Timer {
     static std::string printHelper(std::string str, Snapshot s) {
         std::ostringstream ostr;
         ostr << str << '\n' << s.name + ":\t" << s.getPrintTime() << getTimeUnitString();
+        for (auto& [name, value] : s.metrics) {
+            ostr << '\t' << name << '=' << value;
+        }
 
         for (auto& c : s.children) {
             ostr << printHelper(str, c);
@@ -0,0 +1,226 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef WORKSTEALING_HPP
+#define WORKSTEALING_HPP
+
+#include <omp.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//==--------------------------------------------------------------------==//
+//==------------------- WORK-STEALING EXECUTOR -------------------------==//
+//==--------------------------------------------------------------------==//
+
+// Index ranges handed out to the workers start as this many tasks per thread
+static constexpr size_t WORK_STEALING_TASKS_PER_THREAD = 4;
+
+// Per-thread counters, accumulated over all parallelFor calls until resetStats
+struct WorkerStats {
+    uint64_t busyNanoseconds = 0;
+    uint64_t idleNanoseconds = 0;
+    // Times this worker took half of a sibling's queued tasks
+    uint64_t steals = 0;
+    // Times this worker split the range a sibling was executing
+    uint64_t rangeSplits = 0;
+    uint64_t tasksExecuted = 0;
+    uint64_t itemsProcessed = 0;
+};
+
+// Runs index ranges on a fixed set of OpenMP threads. Every worker owns a deque of ranges and
+// pops its newest task from the back. A worker without tasks steals the older half of a sibling's
+// deque from the front; if all deques are empty, it splits the remaining part of the largest range
+// a sibling is executing and takes the upper half. Ranges are executed grain by grain, so such a
+// split only costs the owner one lock per grain.
+class WorkStealingExecutor {
+  public:
+    explicit WorkStealingExecutor(int numThreads) : workers(std::max(numThreads, 1)) {}
+
+    WorkStealingExecutor(const WorkStealingExecutor&) = delete;
+    WorkStealingExecutor& operator=(const WorkStealingExecutor&) = delete;
+
+    [[nodiscard]] int numThreads() const { return static_cast<int>(workers.size()); }
+
+    // Calls body(begin, end) on disjoint ranges of at most grain items that cover [0, size)
+    template <typename Body>
+    void parallelFor(size_t size, size_t grain, Body&& body) {
+        if (size == 0) {
+            return;
+        }
+        grain = std::max<size_t>(grain, 1);
+        const size_t num_workers = workers.size();
+        const size_t num_tasks = std::min(size, num_workers * WORK_STEALING_TASKS_PER_THREAD);
+        // Worker w starts with a contiguous block of tasks
+        for (size_t task = 0; task < num_tasks; ++task) {
+            workers[task * num_workers / num_tasks].tasks.push_back({task * size / num_tasks, (task + 1) * size / num_tasks});
+        }
+        remaining.store(size, std::memory_order_release);
+
+#pragma omp parallel num_threads(static_cast<int>(num_workers))
+        runWorker(omp_get_thread_num(), grain, body);
+
+        // Tasks of workers OpenMP did not start have been stolen by the others
+        for (Worker& worker : workers) {
+            worker.tasks.clear();
+        }
+    }
+
+    [[nodiscard]] std::vector<WorkerStats> stats() const {
+        std::vector<WorkerStats> result;
+        for (const Worker& worker : workers) {
+            result.push_back(worker.stats);
+        }
+        return result;
+    }
+
+    void resetStats() {
+        for (Worker& worker : workers) {
+            worker.stats = {};
+        }
+    }
+
+  private:
+    struct Range {
+        size_t begin;
+        size_t end;
+    };
+
+    struct alignas(64) Worker {
+        std::mutex mutex;
+        std::deque<Range> tasks;
+        // Rest of the range the worker is executing; siblings may cut off its upper half
+        size_t currentBegin = 0;
+        size_t currentEnd = 0;
+        WorkerStats stats;
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    static uint64_t nanosecondsSince(Clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    }
+
+    template <typename Body>
+    void runWorker(size_t self, size_t grain, Body& body) {
+        Worker& worker = workers[self];
+        Clock::time_point idle_since = Clock::now();
+        while (remaining.load(std::memory_order_acquire) > 0) {
+            Range range{};
+            if (!takeTask(self, grain, range)) {
+                std::this_thread::yield();
+                continue;
+            }
+            worker.stats.idleNanoseconds += nanosecondsSince(idle_since);
+            execute(worker, range, grain, body);
+            idle_since = Clock::now();
+        }
+        worker.stats.idleNanoseconds += nanosecondsSince(idle_since);
+    }
+
+    bool takeTask(size_t self, size_t grain, Range& range) {
+        Worker& worker = workers[self];
+        {
+            const std::lock_guard lock(worker.mutex);
+            if (!worker.tasks.empty()) {
+                range = worker.tasks.back();
+                worker.tasks.pop_back();
+                return true;
+            }
+        }
+
+        // Steal the older half of the first sibling deque that has tasks
+        for (size_t offset = 1; offset < workers.size(); ++offset) {
+            Worker& victim = workers[(self + offset) % workers.size()];
+            std::vector<Range> stolen;
+            {
+                const std::lock_guard lock(victim.mutex);
+                const size_t count = (victim.tasks.size() + 1) / 2;
+                stolen.assign(victim.tasks.begin(), victim.tasks.begin() + static_cast<ptrdiff_t>(count));
+                victim.tasks.erase(victim.tasks.begin(), victim.tasks.begin() + static_cast<ptrdiff_t>(count));
+            }
+            if (!stolen.empty()) {
+                range = stolen.front();
+                const std::lock_guard lock(worker.mutex);
+                worker.tasks.insert(worker.tasks.end(), stolen.begin() + 1, stolen.end());
+                worker.stats.steals++;
+                return true;
+            }
+        }
+
+        // Split the largest range a sibling is still executing
+        size_t largest = self;
+        size_t largest_size = 0;
+        for (size_t other = 0; other < workers.size(); ++other) {
+            if (other != self) {
+                const std::lock_guard lock(workers[other].mutex);
+                if (workers[other].currentEnd - workers[other].currentBegin > largest_size) {
+                    largest_size = workers[other].currentEnd - workers[other].currentBegin;
+                    largest = other;
+                }
+            }
+        }
+        if (largest_size < 2 * grain) {
+            return false;
+        }
+        Worker& victim = workers[largest];
+        const std::lock_guard lock(victim.mutex);
+        if (victim.currentEnd - victim.currentBegin < 2 * grain) {
+            return false;
+        }
+        const size_t middle = victim.currentBegin + (victim.currentEnd - victim.currentBegin) / 2;
+        range = {middle, victim.currentEnd};
+        victim.currentEnd = middle;
+        worker.stats.rangeSplits++;
+        return true;
+    }
+
+    template <typename Body>
+    void execute(Worker& worker, Range range, size_t grain, Body& body) {
+        {
+            const std::lock_guard lock(worker.mutex);
+            worker.currentBegin = range.begin;
+            worker.currentEnd = range.end;
+        }
+        worker.stats.tasksExecuted++;
+        while (true) {
+            size_t begin;
+            size_t end;
+            {
+                const std::lock_guard lock(worker.mutex);
+                if (worker.currentBegin >= worker.currentEnd) {
+                    break;
+                }
+                begin = worker.currentBegin;
+                end = std::min(begin + grain, worker.currentEnd);
+                worker.currentBegin = end;
+            }
+            const Clock::time_point start = Clock::now();
+            body(begin, end);
+            worker.stats.busyNanoseconds += nanosecondsSince(start);
+            worker.stats.itemsProcessed += end - begin;
+            remaining.fetch_sub(end - begin, std::memory_order_acq_rel);
+        }
+    }
+
+    std::vector<Worker> workers;
+    std::atomic<size_t> remaining{0};
+};
+
+#endif // WORKSTEALING_HPP
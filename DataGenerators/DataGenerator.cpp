@@ -0,0 +1,192 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "DataGenerator.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+//==--------------------------------------------------------------------==//
+//==----------------------------- TESTS --------------------------------==//
+//==--------------------------------------------------------------------==//
+
+static GeneratorOptions createTestOptions(const std::string& name) {
+    GeneratorOptions options;
+    options.castRows = 200'000;
+    options.titleRows = 40'000;
+    options.directory = (std::filesystem::temp_directory_path() / "ppds_generator_test").string();
+    options.name = name;
+    return options;
+}
+
+static std::string readFile(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+static void removeOutput(const GeneratorOptions& options) {
+    for (const std::string& filename : {castFilename(options), titleFilename(options)}) {
+        std::filesystem::remove(filename);
+        std::filesystem::remove(snapshotFilename(filename));
+    }
+}
+
+TEST(DataGeneratorTest, TestOutputIsDeterministicForAnyThreadCount) {
+    GeneratorOptions single = createTestOptions("single");
+    single.numThreads = 1;
+    GeneratorOptions parallel = createTestOptions("parallel");
+    parallel.numThreads = 4;
+    GeneratorOptions reseeded = createTestOptions("reseeded");
+    reseeded.seed = 7;
+    ASSERT_TRUE(generateRelations(single));
+    ASSERT_TRUE(generateRelations(parallel));
+    ASSERT_TRUE(generateRelations(reseeded));
+
+    EXPECT_EQ(readFile(castFilename(single)), readFile(castFilename(parallel)));
+    EXPECT_EQ(readFile(titleFilename(single)), readFile(titleFilename(parallel)));
+    EXPECT_NE(readFile(castFilename(single)), readFile(castFilename(reseeded)));
+
+    removeOutput(single);
+    removeOutput(parallel);
+    removeOutput(reseeded);
+}
+
+TEST(DataGeneratorTest, TestSortedRelationsHaveRequestedShape) {
+    GeneratorOptions options = createTestOptions("shape");
+    options.matchRatio = 0.75;
+    options.noteLength = {3, 9};
+    GeneratorStats stats;
+    ASSERT_TRUE(generateRelations(options, &stats));
+
+    const auto casts = loadCastRelation(castFilename(options));
+    const auto titles = loadTitleRelation(titleFilename(options));
+    ASSERT_EQ(casts.size(), options.castRows);
+    ASSERT_EQ(titles.size(), options.titleRows);
+    EXPECT_TRUE(std::ranges::is_sorted(casts, {}, &CastRelation::movieId));
+    EXPECT_TRUE(std::ranges::is_sorted(titles, {}, &TitleRelation::titleId));
+
+    const auto matching = std::ranges::count_if(casts, [&](const CastRelation& cast) {
+        return cast.movieId >= 1 && cast.movieId <= static_cast<int32_t>(options.titleRows);
+    });
+    EXPECT_EQ(static_cast<uint64_t>(matching), stats.matchingCastRows);
+    EXPECT_EQ(stats.matchingCastRows, 150'000u);
+    for (const CastRelation& cast : casts) {
+        const size_t length = strnlen(cast.note, sizeof(cast.note));
+        ASSERT_GE(length, 3u);
+        ASSERT_LE(length, 9u);
+    }
+    removeOutput(options);
+}
+
+TEST(DataGeneratorTest, TestUnsortedRelationsAreShuffledCopies) {
+    GeneratorOptions sorted = createTestOptions("sorted");
+    GeneratorOptions unsorted = createTestOptions("unsorted");
+    unsorted.sorted = false;
+    ASSERT_TRUE(generateRelations(sorted));
+    ASSERT_TRUE(generateRelations(unsorted));
+
+    auto sortedCasts = loadCastRelation(castFilename(sorted));
+    auto unsortedCasts = loadCastRelation(castFilename(unsorted));
+    EXPECT_FALSE(std::ranges::is_sorted(unsortedCasts, {}, &CastRelation::movieId));
+    std::ranges::sort(unsortedCasts, {}, &CastRelation::castInfoId);
+    ASSERT_EQ(unsortedCasts.size(), sortedCasts.size());
+    for (size_t i = 0; i < sortedCasts.size(); ++i) {
+        ASSERT_EQ(castRelationToString(unsortedCasts[i]), castRelationToString(sortedCasts[i]));
+    }
+
+    auto unsortedTitles = loadTitleRelation(titleFilename(unsorted));
+    EXPECT_FALSE(std::ranges::is_sorted(unsortedTitles, {}, &TitleRelation::titleId));
+    std::ranges::sort(unsortedTitles, {}, &TitleRelation::titleId);
+    EXPECT_TRUE(std::ranges::equal(unsortedTitles, loadTitleRelation(titleFilename(sorted)), {}, titleRelationToString, titleRelationToString));
+
+    removeOutput(sorted);
+    removeOutput(unsorted);
+}
+
+TEST(DataGeneratorTest, TestZipfConcentratesOnFewTitles) {
+    GeneratorOptions options = createTestOptions("zipf");
+    options.distribution = KeyDistribution::Zipf;
+    ASSERT_TRUE(generateRelations(options));
+
+    std::map<int32_t, size_t> perTitle;
+    for (const CastRelation& cast : loadCastRelation(castFilename(options))) {
+        perTitle[cast.movieId]++;
+    }
+    // With exponent 1 over 40000 titles the hottest title alone holds several percent of the tuples
+    EXPECT_GT(perTitle[1], options.castRows / 50);
+    EXPECT_GT(perTitle[1], 10 * perTitle[100]);
+    EXPECT_LT(perTitle.size(), options.titleRows);
+    removeOutput(options);
+}
+
+TEST(DataGeneratorTest, TestSnapshotMatchesCsv) {
+    GeneratorOptions options = createTestOptions("snapshot");
+    options.writeSnapshot = true;
+    ASSERT_TRUE(generateRelations(options));
+
+    const auto casts = loadCastRelation(castFilename(options));
+    CastColumns castColumns;
+    const SnapshotSource source = snapshotSource(castFilename(options));
+    ASSERT_TRUE(readSnapshot(snapshotFilename(castFilename(options)), castColumns, SIZE_MAX, &source));
+    ASSERT_EQ(castColumns.size(), casts.size());
+    for (size_t i = 0; i < casts.size(); ++i) {
+        ASSERT_EQ(castRelationToString(castColumns[i]), castRelationToString(casts[i]));
+    }
+
+    const auto titles = loadTitleRelation(titleFilename(options));
+    const TitleColumns titleColumns = loadTitleColumnsWithSnapshot(titleFilename(options));
+    ASSERT_EQ(titleColumns.size(), titles.size());
+    for (size_t i = 0; i < titles.size(); ++i) {
+        ASSERT_EQ(titleRelationToString(titleColumns[i]), titleRelationToString(titles[i]));
+    }
+    removeOutput(options);
+}
+
+TEST(DataGeneratorTest, TestInMemoryRelationsMatchFiles) {
+    GeneratorOptions options = createTestOptions("in_memory");
+    options.sorted = false;
+    options.matchRatio = 0.5;
+    ASSERT_TRUE(generateRelations(options));
+
+    const auto [casts, titles] = generateRelationsInMemory(options);
+    const auto loadedCasts = loadCastRelation(castFilename(options));
+    const auto loadedTitles = loadTitleRelation(titleFilename(options));
+    ASSERT_EQ(casts.size(), loadedCasts.size());
+    ASSERT_EQ(titles.size(), loadedTitles.size());
+    for (size_t i = 0; i < casts.size(); ++i) {
+        ASSERT_EQ(castRelationToString(casts[i]), castRelationToString(loadedCasts[i]));
+    }
+    for (size_t i = 0; i < titles.size(); ++i) {
+        ASSERT_EQ(titleRelationToString(titles[i]), titleRelationToString(loadedTitles[i]));
+    }
+    removeOutput(options);
+}
+
+TEST(DataGeneratorTest, TestRowPermutationIsBijective) {
+    for (const uint64_t size : {1u, 2u, 3u, 1000u, 4097u}) {
+        const RowPermutation permutation(size, 11);
+        std::set<uint64_t> values;
+        for (uint64_t i = 0; i < size; ++i) {
+            values.insert(permutation(i));
+        }
+        EXPECT_EQ(values.size(), size);
+        EXPECT_LT(*values.rbegin(), size);
+    }
+}
@@ -0,0 +1,511 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef DATAGENERATOR_HPP
+#define DATAGENERATOR_HPP
+
+#include "RelationSnapshot.hpp"
+#include <omp.h>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+//==--------------------------------------------------------------------==//
+//==----------------------- GENERATOR OPTIONS --------------------------==//
+//==--------------------------------------------------------------------==//
+
+// Distribution of the cast movieIds over the titles
+enum class KeyDistribution {
+    Uniform,
+    // Title rank r gets a share proportional to 1 / r^zipfExponent; low titleIds are the hot ones
+    Zipf,
+};
+
+// Inclusive range of string lengths
+struct LengthRange {
+    size_t min;
+    size_t max;
+};
+
+struct GeneratorOptions {
+    uint64_t castRows = 1'000'000;
+    uint64_t titleRows = 250'000;
+    KeyDistribution distribution = KeyDistribution::Uniform;
+    double zipfExponent = 1.0;
+    // Fraction of cast tuples whose movieId belongs to a title; the others point above all titleIds
+    double matchRatio = 1.0;
+    // Cast tuples sorted by movieId and titles by titleId, as in the IMDB exports. Otherwise both
+    // relations hold the same tuples in a pseudo random order.
+    bool sorted = true;
+    LengthRange noteLength{0, 24};
+    LengthRange titleLength{4, 48};
+    uint64_t seed = 42;
+    int numThreads = defaultLoadThreads();
+    bool writeCsv = true;
+    // Binary columnar snapshot next to the CSV file (RelationSnapshot.hpp), which loadWithSnapshot
+    // picks up instead of parsing the CSV
+    bool writeSnapshot = false;
+    std::string directory = ".";
+    // Files are named cast_info_<name>.csv and title_info_<name>.csv
+    std::string name = "uniform";
+};
+
+struct GeneratorStats {
+    uint64_t castRows = 0;
+    uint64_t titleRows = 0;
+    uint64_t matchingCastRows = 0;
+    uint64_t bytesWritten = 0;
+    double seconds = 0;
+};
+
+// Rows generated and formatted by one task
+static constexpr uint64_t GENERATOR_BLOCK_ROWS = 1 << 16;
+// Blocks generated per thread before they are appended to the CSV file in order
+static constexpr uint64_t GENERATOR_BLOCKS_PER_THREAD = 4;
+
+inline std::string castFilename(const GeneratorOptions& options) {
+    return (std::filesystem::path(options.directory) / ("cast_info_" + options.name + ".csv")).string();
+}
+
+inline std::string titleFilename(const GeneratorOptions& options) {
+    return (std::filesystem::path(options.directory) / ("title_info_" + options.name + ".csv")).string();
+}
+
+//==--------------------------------------------------------------------==//
+//==------------------ DETERMINISTIC RANDOM VALUES ---------------------==//
+//==--------------------------------------------------------------------==//
+
+// Every random value is a pure function of (seed, stream, row), so the output is the same for
+// every thread count and block size.
+enum class RandomStream : uint64_t {
+    CastKey = 1,
+    CastPayload,
+    CastOrder,
+    TitlePayload,
+    TitleOrder,
+};
+
+static constexpr uint64_t GOLDEN_GAMMA = 0x9E3779B97F4A7C15ULL;
+
+// SplitMix64 finalizer
+inline uint64_t mixBits(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// SplitMix64 sequence that belongs to one row of one stream
+class RowRandom {
+  public:
+    RowRandom(uint64_t seed, RandomStream stream, uint64_t row)
+        : state(mixBits(mixBits(seed + static_cast<uint64_t>(stream) * GOLDEN_GAMMA) ^ row)) {}
+
+    uint64_t next() {
+        state += GOLDEN_GAMMA;
+        return mixBits(state);
+    }
+
+    // Uniform in [0, 1)
+    double unit() { return static_cast<double>(next() >> 11) * 0x1.0p-53; }
+
+    // Uniform in [0, bound); the modulo bias is negligible for the small bounds used here
+    uint64_t below(uint64_t bound) { return bound == 0 ? 0 : next() % bound; }
+
+    size_t length(LengthRange range) { return range.min + below(range.max - std::min(range.min, range.max) + 1); }
+
+  private:
+    uint64_t state;
+};
+
+// Bijection of [0, size) for shuffling without materializing a permutation: a four round Feistel
+// network over the next even power of two, where values outside the range are sent through the
+// network again until they land inside (cycle walking).
+class RowPermutation {
+  public:
+    RowPermutation(uint64_t size, uint64_t seed) : size(size) {
+        halfBits = (std::max<unsigned>(std::bit_width(size), 2) + 1) / 2;
+        mask = (uint64_t{1} << halfBits) - 1;
+        for (uint64_t round = 0; round < 4; ++round) {
+            keys[round] = mixBits(seed + (round + 1) * GOLDEN_GAMMA);
+        }
+    }
+
+    uint64_t operator()(uint64_t index) const {
+        uint64_t value = index;
+        do {
+            value = encrypt(value);
+        } while (value >= size);
+        return value;
+    }
+
+  private:
+    [[nodiscard]] uint64_t encrypt(uint64_t value) const {
+        uint64_t left = value >> halfBits;
+        uint64_t right = value & mask;
+        for (const uint64_t key : keys) {
+            const uint64_t next = left ^ (mixBits(right ^ key) & mask);
+            left = right;
+            right = next;
+        }
+        return (left << halfBits) | right;
+    }
+
+    uint64_t size;
+    unsigned halfBits;
+    uint64_t mask;
+    uint64_t keys[4];
+};
+
+//==--------------------------------------------------------------------==//
+//==------------------------- ROW GENERATION ---------------------------==//
+//==--------------------------------------------------------------------==//
+
+inline uint64_t matchingCastRows(const GeneratorOptions& options) {
+    if (options.titleRows == 0) {
+        return 0;
+    }
+    return static_cast<uint64_t>(std::llround(static_cast<double>(options.castRows) * std::clamp(options.matchRatio, 0.0, 1.0)));
+}
+
+// Title rank in [0, titles) at quantile u. Zipf uses the inverse of the continuous power law on
+// [1, titles + 1), which is close to the discrete distribution without a table per title.
+inline uint64_t titleRankAtQuantile(double u, uint64_t titles, const GeneratorOptions& options) {
+    double rank = u * static_cast<double>(titles);
+    if (options.distribution == KeyDistribution::Zipf) {
+        const double exponent = 1.0 - options.zipfExponent;
+        const double upper = static_cast<double>(titles) + 1.0;
+        rank = std::abs(exponent) < 1e-9 ? std::pow(upper, u) - 1.0 : std::pow(1.0 + u * (std::pow(upper, exponent) - 1.0), 1.0 / exponent) - 1.0;
+    }
+    return std::min(static_cast<uint64_t>(std::max(rank, 0.0)), titles - 1);
+}
+
+// movieId of the cast tuple at position row of the sorted relation. Row i draws its quantile
+// from [i, i + 1) / rows (jittered stratified sampling), which makes the keys non-decreasing in
+// the row number, so any block of rows can be generated independently and still comes out sorted.
+// Matching rows come first; the others get keys above the largest titleId.
+inline int32_t castKeyOfSortedRow(uint64_t row, const GeneratorOptions& options, uint64_t matchingRows) {
+    RowRandom random(options.seed, RandomStream::CastKey, row);
+    if (row < matchingRows) {
+        const double u = (static_cast<double>(row) + random.unit()) / static_cast<double>(matchingRows);
+        return static_cast<int32_t>(titleRankAtQuantile(u, options.titleRows, options) + 1);
+    }
+    const uint64_t others = options.castRows - matchingRows;
+    const double u = (static_cast<double>(row - matchingRows) + random.unit()) / static_cast<double>(others);
+    const uint64_t range = std::max<uint64_t>(options.titleRows, 1);
+    return static_cast<int32_t>(options.titleRows + 1 + std::min(static_cast<uint64_t>(u * static_cast<double>(range)), range - 1));
+}
+
+// Random letters, digits and inner blanks; commas and line breaks never occur, so the CSV needs no quoting
+template <size_t Size>
+void fillText(char (&target)[Size], size_t length, RowRandom& random) {
+    static constexpr char alphabet[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 ";
+    length = std::min(length, Size - 1);
+    for (size_t i = 0; i < length; ++i) {
+        const char c = alphabet[random.below(sizeof(alphabet) - 1)];
+        target[i] = c == ' ' && (i == 0 || i + 1 == length) ? 'x' : c;
+    }
+    std::memset(target + length, 0, Size - length);
+}
+
+// Cast tuple at position sortedRow of the sorted relation
+inline CastRelation generateCastRow(uint64_t sortedRow, const GeneratorOptions& options, uint64_t matchingRows) {
+    RowRandom random(options.seed, RandomStream::CastPayload, sortedRow);
+    CastRelation cast{};
+    cast.castInfoId = static_cast<int32_t>(sortedRow + 1);
+    cast.personId = static_cast<int32_t>(1 + random.below(4'000'000));
+    cast.movieId = castKeyOfSortedRow(sortedRow, options, matchingRows);
+    cast.personRoleId = static_cast<int32_t>(1 + random.below(3'000'000));
+    fillText(cast.note, random.length(options.noteLength), random);
+    cast.nrOrder = static_cast<int32_t>(1 + random.below(50));
+    cast.roleId = static_cast<int32_t>(1 + random.below(11));
+    return cast;
+}
+
+// Title tuple with titleId id + 1
+inline TitleRelation generateTitleRow(uint64_t id, const GeneratorOptions& options) {
+    static constexpr char hex[] = "0123456789abcdef";
+    RowRandom random(options.seed, RandomStream::TitlePayload, id);
+    TitleRelation title{};
+    title.titleId = static_cast<int32_t>(id + 1);
+    fillText(title.title, random.length(options.titleLength), random);
+    if (random.below(8) == 0) {
+        title.imdbIndex[0] = 'I';
+    }
+    title.kindId = static_cast<int32_t>(1 + random.below(7));
+    title.productionYear = static_cast<int32_t>(1880 + random.below(145));
+    title.imdbId = static_cast<int32_t>(1 + random.below(9'999'999));
+    title.phoneticCode[0] = static_cast<char>('A' + random.below(26));
+    for (size_t i = 1; i < sizeof(title.phoneticCode) - 1; ++i) {
+        title.phoneticCode[i] = static_cast<char>('0' + random.below(10));
+    }
+    // The loader fills all 32 bytes of md5sum, so there is no terminator either
+    for (char& c : title.md5sum) {
+        c = hex[random.below(16)];
+    }
+    return title;
+}
+
+//==--------------------------------------------------------------------==//
+//==--------------------------- CSV OUTPUT -----------------------------==//
+//==--------------------------------------------------------------------==//
+
+inline void appendField(std::string& line, int32_t value) {
+    char buffer[16];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    line.append(buffer, result.ptr);
+}
+
+template <size_t Size>
+void appendField(std::string& line, const char (&text)[Size]) {
+    line += fieldText(text);
+}
+
+template <typename... Fields>
+void appendCsvLine(std::string& out, const Fields&... fields) {
+    size_t index = 0;
+    ((out += index++ == 0 ? "" : ",", appendField(out, fields)), ...);
+    out += '\n';
+}
+
+inline void appendCsvLine(std::string& out, const CastRelation& r) {
+    appendCsvLine(out, r.castInfoId, r.personId, r.movieId, r.personRoleId, r.note, r.nrOrder, r.roleId);
+}
+
+inline void appendCsvLine(std::string& out, const TitleRelation& r) {
+    appendCsvLine(out, r.titleId, r.title, r.imdbIndex, r.kindId, r.productionYear, r.imdbId, r.phoneticCode, r.episodeOfId,
+                  r.seasonNr, r.episodeNr, r.seriesYears, r.md5sum);
+}
+
+inline const char* csvHeader(const CastRelation&) {
+    return "id,person_id,movie_id,person_role_id,note,nr_order,role_id\n";
+}
+
+inline const char* csvHeader(const TitleRelation&) {
+    return "id,title,imdb_index,kind_id,production_year,imdb_id,phonetic_code,episode_of_id,season_nr,episode_nr,series_years,md5sum\n";
+}
+
+//==--------------------------------------------------------------------==//
+//==------------------------ RELATION WRITER ---------------------------==//
+//==--------------------------------------------------------------------==//
+
+inline bool writeFully(int fd, const void* data, size_t bytes, uint64_t offset) {
+    const char* position = static_cast<const char*>(data);
+    while (bytes > 0) {
+        const ssize_t written = pwrite(fd, position, bytes, static_cast<off_t>(offset));
+        if (written <= 0) {
+            return false;
+        }
+        position += written;
+        bytes -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+    return true;
+}
+
+// Writes rows [0, rows) produced by makeRow(row) as CSV file and/or snapshot. Rounds of blocks
+// are generated in parallel; their CSV text is appended in block order afterwards, while the
+// snapshot columns go straight to their final offsets with pwrite.
+template <typename Relation, typename Columns, typename MakeRow>
+bool writeRelation(const std::string& filename, uint64_t rows, bool sortedByKey, const GeneratorOptions& options, MakeRow&& makeRow) {
+    std::ofstream csv;
+    if (options.writeCsv) {
+        csv.open(filename, std::ios::binary | std::ios::trunc);
+        if (!csv) {
+            std::cerr << "Error: Failed to create " << filename << std::endl;
+            return false;
+        }
+        csv << csvHeader(Relation{});
+    }
+
+    const std::string snapshot = snapshotFilename(filename);
+    const std::string temporary = snapshot + ".tmp";
+    SnapshotHeader header = createSnapshotHeader<Columns>(rows, sortedByKey);
+    int fd = -1;
+    if (options.writeSnapshot) {
+        fd = open(temporary.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+        if (fd < 0 || ftruncate(fd, static_cast<off_t>(snapshotFileSize(header))) != 0) {
+            std::cerr << "Error: Failed to create " << temporary << std::endl;
+            if (fd >= 0) {
+                close(fd);
+            }
+            return false;
+        }
+    }
+
+    const uint64_t num_blocks = (rows + GENERATOR_BLOCK_ROWS - 1) / GENERATOR_BLOCK_ROWS;
+    const uint64_t blocks_per_round = static_cast<uint64_t>(std::max(options.numThreads, 1)) * GENERATOR_BLOCKS_PER_THREAD;
+    std::vector<std::string> texts(std::min(num_blocks, blocks_per_round));
+    std::atomic<bool> failed{false};
+
+    for (uint64_t first_block = 0; first_block < num_blocks && !failed; first_block += blocks_per_round) {
+        const uint64_t round_blocks = std::min(blocks_per_round, num_blocks - first_block);
+
+#pragma omp parallel for schedule(dynamic) num_threads(options.numThreads) shared(texts, failed, header, makeRow)
+        for (uint64_t b = 0; b < round_blocks; ++b) {
+            const uint64_t begin = (first_block + b) * GENERATOR_BLOCK_ROWS;
+            const uint64_t end = std::min(begin + GENERATOR_BLOCK_ROWS, rows);
+            RelationVector<Relation> block;
+            block.reserve(end - begin);
+            for (uint64_t row = begin; row < end; ++row) {
+                block.push_back(makeRow(row));
+            }
+
+            if (options.writeCsv) {
+                std::string& text = texts[b];
+                text.clear();
+                for (const Relation& tuple : block) {
+                    appendCsvLine(text, tuple);
+                }
+            }
+            if (options.writeSnapshot) {
+                const Columns columns = toColumns(block);
+                uint32_t index = 0;
+                Columns::forEachColumn(columns, [&](const auto& column) {
+                    const SnapshotColumn& entry = header.columns[index++];
+                    if (!writeFully(fd, column.data(), column.size() * entry.elementSize, entry.offset + begin * entry.elementSize)) {
+                        failed = true;
+                    }
+                });
+            }
+        }
+
+        if (options.writeCsv) {
+            for (uint64_t b = 0; b < round_blocks; ++b) {
+                csv.write(texts[b].data(), static_cast<std::streamsize>(texts[b].size()));
+            }
+        }
+    }
+
+    if (options.writeCsv) {
+        csv.close();
+        failed = failed || csv.fail();
+    }
+    if (options.writeSnapshot) {
+        // The header goes in last, stamped with the finished CSV file, so the loader accepts the snapshot
+        header = createSnapshotHeader<Columns>(rows, sortedByKey, options.writeCsv ? snapshotSource(filename) : SnapshotSource{});
+        failed = failed || !writeFully(fd, &header, sizeof(header), 0);
+        failed = failed || close(fd) != 0;
+        std::error_code error;
+        if (failed) {
+            std::filesystem::remove(temporary, error);
+        } else {
+            std::filesystem::rename(temporary, snapshot, error);
+            failed = static_cast<bool>(error);
+        }
+    }
+    if (failed) {
+        std::cerr << "Error: Failed to write " << filename << std::endl;
+    }
+    return !failed;
+}
+
+inline uint64_t fileSizeOrZero(const std::string& filename) {
+    std::error_code error;
+    const auto size = std::filesystem::file_size(filename, error);
+    return error ? 0 : static_cast<uint64_t>(size);
+}
+
+// Order of the rows of unsorted relations
+inline RowPermutation titleOrder(const GeneratorOptions& options) {
+    return {options.titleRows, mixBits(options.seed ^ static_cast<uint64_t>(RandomStream::TitleOrder))};
+}
+
+inline RowPermutation castOrder(const GeneratorOptions& options) {
+    return {options.castRows, mixBits(options.seed ^ static_cast<uint64_t>(RandomStream::CastOrder))};
+}
+
+inline bool validRowCounts(const GeneratorOptions& options) {
+    if (options.castRows > INT32_MAX || options.titleRows >= INT32_MAX / 2) {
+        std::cerr << "Error: Row counts exceed the int32 key range" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Generates the cast and title relations described by options into options.directory.
+// Returns false if a file could not be written.
+inline bool generateRelations(const GeneratorOptions& options, GeneratorStats* statsOut = nullptr) {
+    if (!validRowCounts(options)) {
+        return false;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    std::error_code error;
+    std::filesystem::create_directories(options.directory, error);
+
+    const uint64_t matching_rows = matchingCastRows(options);
+    const RowPermutation title_order = titleOrder(options);
+    const RowPermutation cast_order = castOrder(options);
+
+    const bool titles_written = writeRelation<TitleRelation, TitleColumns>(titleFilename(options), options.titleRows, options.sorted, options, [&](uint64_t row) {
+        return generateTitleRow(options.sorted ? row : title_order(row), options);
+    });
+    const bool casts_written = titles_written && writeRelation<CastRelation, CastColumns>(castFilename(options), options.castRows, options.sorted, options, [&](uint64_t row) {
+        return generateCastRow(options.sorted ? row : cast_order(row), options, matching_rows);
+    });
+
+    if (statsOut != nullptr) {
+        GeneratorStats& stats = *statsOut;
+        stats.castRows = options.castRows;
+        stats.titleRows = options.titleRows;
+        stats.matchingCastRows = matching_rows;
+        stats.bytesWritten = 0;
+        for (const std::string& filename : {titleFilename(options), castFilename(options)}) {
+            stats.bytesWritten += (options.writeCsv ? fileSizeOrZero(filename) : 0) + (options.writeSnapshot ? fileSizeOrZero(snapshotFilename(filename)) : 0);
+        }
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    return casts_written;
+}
+
+// Generates the relations described by options in memory, in parallel; the rows are the same as
+// in the files of generateRelations. The output options are ignored. Returns empty relations if
+// the row counts exceed the key range.
+inline std::pair<RelationVector<CastRelation>, RelationVector<TitleRelation>> generateRelationsInMemory(const GeneratorOptions& options) {
+    if (!validRowCounts(options)) {
+        return {};
+    }
+    const uint64_t matching_rows = matchingCastRows(options);
+    const RowPermutation title_order = titleOrder(options);
+    const RowPermutation cast_order = castOrder(options);
+
+    RelationVector<TitleRelation> titles(options.titleRows);
+    RelationVector<CastRelation> casts(options.castRows);
+#pragma omp parallel num_threads(options.numThreads) shared(options, matching_rows, title_order, cast_order, titles, casts)
+    {
+#pragma omp for schedule(static)
+        for (uint64_t row = 0; row < options.titleRows; ++row) {
+            titles[row] = generateTitleRow(options.sorted ? row : title_order(row), options);
+        }
+#pragma omp for schedule(static)
+        for (uint64_t row = 0; row < options.castRows; ++row) {
+            casts[row] = generateCastRow(options.sorted ? row : cast_order(row), options, matching_rows);
+        }
+    }
+    return {std::move(casts), std::move(titles)};
+}
+
+#endif // DATAGENERATOR_HPP
@@ -0,0 +1,131 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "DataGenerator.hpp"
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "  --cast-rows N          cast tuples (default 1000000)\n"
+              << "  --title-rows N         title tuples (default 250000)\n"
+              << "  --distribution D       uniform or zipf (default uniform)\n"
+              << "  --zipf-exponent S      skew of the zipf distribution (default 1.0)\n"
+              << "  --match-ratio R        fraction of cast tuples with a matching title (default 1.0)\n"
+              << "  --unsorted             shuffle both relations instead of sorting them by key\n"
+              << "  --note-length MIN:MAX  length of the cast notes (default 0:24)\n"
+              << "  --title-length MIN:MAX length of the titles (default 4:48)\n"
+              << "  --seed N               seed of all random values (default 42)\n"
+              << "  --threads N            generator threads (default all)\n"
+              << "  --format F             csv, snapshot or both (default csv)\n"
+              << "  --output DIR           output directory (default " << DATA_DIRECTORY << ")\n"
+              << "  --name NAME            writes cast_info_NAME.csv and title_info_NAME.csv (default: the distribution)\n";
+}
+
+static bool parseLengthRange(std::string_view text, LengthRange& range) {
+    const size_t colon = text.find(':');
+    if (colon == std::string_view::npos) {
+        return false;
+    }
+    range.min = std::stoull(std::string(text.substr(0, colon)));
+    range.max = std::stoull(std::string(text.substr(colon + 1)));
+    return range.min <= range.max;
+}
+
+static bool parseArguments(int argc, char** argv, GeneratorOptions& options) {
+    bool named = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view argument = argv[i];
+        if (argument == "--unsorted") {
+            options.sorted = false;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            return false;
+        }
+        const std::string value = argv[++i];
+        if (argument == "--cast-rows") {
+            options.castRows = std::stoull(value);
+        } else if (argument == "--title-rows") {
+            options.titleRows = std::stoull(value);
+        } else if (argument == "--distribution") {
+            if (value == "uniform") {
+                options.distribution = KeyDistribution::Uniform;
+            } else if (value == "zipf") {
+                options.distribution = KeyDistribution::Zipf;
+            } else {
+                return false;
+            }
+        } else if (argument == "--zipf-exponent") {
+            options.zipfExponent = std::stod(value);
+        } else if (argument == "--match-ratio") {
+            options.matchRatio = std::stod(value);
+        } else if (argument == "--note-length") {
+            if (!parseLengthRange(value, options.noteLength)) {
+                return false;
+            }
+        } else if (argument == "--title-length") {
+            if (!parseLengthRange(value, options.titleLength)) {
+                return false;
+            }
+        } else if (argument == "--seed") {
+            options.seed = std::stoull(value);
+        } else if (argument == "--threads") {
+            options.numThreads = std::max(std::stoi(value), 1);
+        } else if (argument == "--format") {
+            options.writeCsv = value == "csv" || value == "both";
+            options.writeSnapshot = value == "snapshot" || value == "both";
+            if (!options.writeCsv && !options.writeSnapshot) {
+                return false;
+            }
+        } else if (argument == "--output") {
+            options.directory = value;
+        } else if (argument == "--name") {
+            options.name = value;
+            named = true;
+        } else {
+            return false;
+        }
+    }
+    if (!named) {
+        options.name = options.distribution == KeyDistribution::Zipf ? "zipf" : "uniform";
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    GeneratorOptions options;
+    options.directory = DATA_DIRECTORY;
+    try {
+        if (!parseArguments(argc, argv, options)) {
+            printUsage(argv[0]);
+            return 1;
+        }
+    } catch (const std::exception&) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    GeneratorStats stats;
+    if (!generateRelations(options, &stats)) {
+        return 1;
+    }
+    std::cout << "Generated " << stats.castRows << " cast tuples (" << stats.matchingCastRows << " matching) and " << stats.titleRows
+              << " title tuples in " << options.directory << std::endl;
+    std::cout << "Wrote " << stats.bytesWritten / 1e6 << " MB in " << stats.seconds << " s (" << stats.bytesWritten / 1e6 / stats.seconds
+              << " MB/s)" << std::endl;
+    return 0;
+}